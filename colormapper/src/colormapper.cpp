@@ -13,6 +13,7 @@
 #include "colormapper.h"
 #include "shared/FrameSet.h"
 #include "shared/Frame.h"
+#include "shared/FileMap.h"
 #include "shared/qtgui/qfilewrap.h"
 #include "customwidget.h"
 
@@ -333,7 +334,11 @@ bool ColorMapperWindow::extractColors(const QString &filename)
 {
     QMap<QString, QString> map;
     CFrameSet &fs = *m_frameSet;
-    QFileWrap file;
+    // plain paths are mapped; Qt resources (":/...") are only reachable
+    // through QFile, as in the rest of the window
+    CFileMap mapped;
+    QFileWrap wrapped;
+    IFile &file = filename.startsWith(':') ? static_cast<IFile &>(wrapped) : mapped;
     std::set<uint32_t> colors;
     m_tab2->setFrameSet(nullptr);
     m_frameSet->forget();
@@ -3,11 +3,18 @@ CONFIG += c++20
 INCLUDEPATH += shared/
 SOURCES += main.cpp \
     colormapper.cpp \
+    shared/CRC.cpp \
     shared/DotArray.cpp \
+    shared/FileMap.cpp \
     shared/FileWrap.cpp \
     shared/Frame.cpp \
     shared/FrameSet.cpp \
     shared/PngMagic.cpp \
+    shared/PngFilter.cpp \
+    shared/PixelOps.cpp \
+    shared/PixelPool.cpp \
+    shared/Resampler.cpp \
+    shared/Undo.cpp \
     shared/helper.cpp \
     shared/qtgui/qfilewrap.cpp \
     shared/qtgui/qthelper.cpp \
@@ -17,12 +24,18 @@ HEADERS += \
     colormapper.h \
     shared/CRC.h \
     shared/DotArray.h \
+    shared/FileMap.h \
     shared/FileWrap.h \
     shared/Frame.h \
     shared/FrameSet.h \
     shared/IFile.h \
     shared/ISerial.h \
     shared/PngMagic.h \
+    shared/PngFilter.h \
+    shared/PixelOps.h \
+    shared/PixelPool.h \
+    shared/Resampler.h \
+    shared/Undo.h \
     shared/glhelper.h \
     shared/helper.h \
     shared/qtgui/cheat.h \
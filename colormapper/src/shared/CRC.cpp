@@ -0,0 +1,213 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "CRC.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC_USE_PCLMUL
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    typedef struct
+    {
+        uint32_t t[8][256];
+    } crcTables_t;
+
+    /* Tables of CRCs of all 8-bit messages followed by 0..7 zero bytes,
+       built at compile time. */
+    constexpr crcTables_t makeTables()
+    {
+        crcTables_t tables{};
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                if (c & 1)
+                    c = 0xedb88320L ^ (c >> 1);
+                else
+                    c = c >> 1;
+            }
+            tables.t[0][n] = c;
+        }
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = tables.t[0][n];
+            for (int k = 1; k < 8; k++)
+            {
+                c = tables.t[0][c & 0xff] ^ (c >> 8);
+                tables.t[k][n] = c;
+            }
+        }
+        return tables;
+    }
+
+    constexpr crcTables_t g_tables = makeTables();
+    static_assert(g_tables.t[0][1] == 0x77073096, "bad crc table");
+}
+
+uint32_t CCRC::update_slice8(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    const auto &t = g_tables.t;
+    uint32_t c = crc;
+    while (len && ((uintptr_t)buf & 7))
+    {
+        c = t[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+        --len;
+    }
+    while (len >= 8)
+    {
+        uint32_t one = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24)) ^ c;
+        uint32_t two = buf[4] | (buf[5] << 8) | (buf[6] << 16) | ((uint32_t)buf[7] << 24);
+        c = t[7][one & 0xff] ^
+            t[6][(one >> 8) & 0xff] ^
+            t[5][(one >> 16) & 0xff] ^
+            t[4][one >> 24] ^
+            t[3][two & 0xff] ^
+            t[2][(two >> 8) & 0xff] ^
+            t[1][(two >> 16) & 0xff] ^
+            t[0][two >> 24];
+        buf += 8;
+        len -= 8;
+    }
+    while (len--)
+    {
+        c = t[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+    }
+    return c;
+}
+
+#ifdef CRC_USE_PCLMUL
+
+/* Folding with carry-less multiplication, after Intel's "Fast CRC
+   Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+   Requires len >= 64 and a multiple of 16. */
+__attribute__((target("pclmul,sse4.1"))) static uint32_t update_pclmul(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    // bit-reflected constants for the 0x04c11db7 polynomial
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    x0 = _mm_load_si128((const __m128i *)k1k2);
+    buf += 64;
+    len -= 64;
+
+    // fold 4 x 128 bits in parallel
+    while (len >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    }
+
+    // fold into 128 bits
+    x0 = _mm_load_si128((const __m128i *)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // single folds of 16 bytes
+    while (len >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+}
+
+static bool hasPclmul()
+{
+    static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+}
+
+#endif
+
+unsigned long CCRC::update_crc(
+        unsigned long crc,
+        const unsigned char *buf,
+        int len)
+{
+    uint32_t c = crc;
+    size_t n = len > 0 ? len : 0;
+#ifdef CRC_USE_PCLMUL
+    enum
+    {
+        PCLMUL_MIN_SIZE = 64
+    };
+    if (n >= PCLMUL_MIN_SIZE && hasPclmul())
+    {
+        size_t chunk = n & ~(size_t)15;
+        c = update_pclmul(c, buf, chunk);
+        buf += chunk;
+        n -= chunk;
+    }
+#endif
+    return update_slice8(c, buf, n);
+}
@@ -15,6 +15,10 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
 
 /////////////////////////////////////////////////////////////////////////////
 // CRC
@@ -23,59 +27,23 @@ class CCRC
 {
 
 public:
-    CCRC() {
-        crc_table_computed = 0;
-    }
-
     /* Return the CRC of the bytes buf[0..len-1]. */
-    unsigned long crc(unsigned char *buf, int len) {
+    static unsigned long crc(const unsigned char *buf, int len) {
         return update_crc(0xffffffffL, buf, len) ^ 0xffffffffL;
     }
 
-private:
-
-    /* Table of CRCs of all 8-bit messages. */
-    unsigned long crc_table[256];
-
-    /* Flag: has the table been computed? initially false. */
-    int crc_table_computed;// = 0;
-
-    /* Make the table for a fast CRC. */
-    void make_crc_table(void) {
-        unsigned long c;
-        int n, k;
-
-        for (n = 0; n < 256; n++) {
-            c = (unsigned long) n;
-            for (k = 0; k < 8; k++) {
-                if (c & 1)
-                    c = 0xedb88320L ^ (c >> 1);
-                else
-                    c = c >> 1;
-            }
-            crc_table[n] = c;
-        }
-        crc_table_computed = 1;
-    }
-
     /* Update a running CRC with the bytes buf[0..len-1]--the CRC
            should be initialized to all 1's, and the transmitted value
            is the 1's complement of the final running CRC (see the
-           crc() routine below)). */
+           crc() routine above)).
 
-    unsigned long update_crc(
+       Uses carry-less multiplication folding when the cpu supports
+       it (detected once at runtime) and slicing-by-8 otherwise. */
+    static unsigned long update_crc(
             unsigned long crc,
-            unsigned char *buf,
-            int len) {
-        unsigned long c = crc;
-        int n;
+            const unsigned char *buf,
+            int len);
 
-        if (!crc_table_computed)
-            make_crc_table();
-        for (n = 0; n < len; n++) {
-            c = crc_table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
-        }
-        return c;
-    }
+    /* Portable slicing-by-8 implementation. */
+    static uint32_t update_slice8(uint32_t crc, const uint8_t *buf, size_t len);
 };
- 
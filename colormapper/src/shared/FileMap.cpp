@@ -0,0 +1,259 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileMap.h"
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+CFileMap::CFileMap()
+{
+    m_data = nullptr;
+    m_size = 0;
+    m_ptr = 0;
+    m_mapping = nullptr;
+#ifdef _WIN32
+    m_handle = nullptr;
+#endif
+}
+
+CFileMap::~CFileMap()
+{
+    close();
+}
+
+bool CFileMap::open(const char *fileName, const char *mode)
+{
+    close();
+    if (mode[0] != 'r' || strchr(mode, '+')) {
+        // read-only
+        return false;
+    }
+
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, fileName, -1, nullptr, 0);
+    std::wstring wname(wlen, 0);
+    MultiByteToWideChar(CP_UTF8, 0, fileName, -1, wname.data(), wlen);
+    HANDLE file = CreateFileW(wname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart > 0x7fffffff) {
+        CloseHandle(file);
+        return false;
+    }
+    m_size = (long) size.QuadPart;
+    if (m_size < MAP_THRESHOLD) {
+        m_buffer.resize(m_size);
+        DWORD done = 0;
+        bool ok = !m_size || (ReadFile(file, m_buffer.data(), m_size, &done, nullptr) && (long) done == m_size);
+        CloseHandle(file);
+        if (!ok) {
+            close();
+            return false;
+        }
+        m_data = m_buffer.data();
+    } else {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view) {
+            if (mapping) {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            m_size = 0;
+            return false;
+        }
+        m_handle = file;
+        m_mapping = mapping;
+        m_data = (const uint8_t*) view;
+    }
+#else
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size > 0x7fffffff) {
+        ::close(fd);
+        return false;
+    }
+    m_size = st.st_size;
+    if (m_size < MAP_THRESHOLD) {
+        m_buffer.resize(m_size);
+        long done = 0;
+        while (done < m_size) {
+            ssize_t n = ::read(fd, m_buffer.data() + done, m_size - done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        ::close(fd);
+        if (done != m_size) {
+            close();
+            return false;
+        }
+        m_data = m_buffer.data();
+    } else {
+        void *view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            m_size = 0;
+            return false;
+        }
+        madvise(view, m_size, MADV_SEQUENTIAL);
+        m_mapping = view;
+        m_data = (const uint8_t*) view;
+    }
+#endif
+    m_ptr = 0;
+    return true;
+}
+
+void CFileMap::close()
+{
+    if (m_mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle((HANDLE) m_mapping);
+        CloseHandle((HANDLE) m_handle);
+        m_handle = nullptr;
+#else
+        munmap(m_mapping, m_size);
+#endif
+        m_mapping = nullptr;
+    }
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_ptr = 0;
+}
+
+const uint8_t *CFileMap::data()
+{
+    return m_data;
+}
+
+std::span<const uint8_t> CFileMap::span() const
+{
+    return std::span<const uint8_t>(m_data, m_size);
+}
+
+int CFileMap::read(void *buf, int size)
+{
+    int n = std::max(0L, std::min((long) size, m_size - m_ptr));
+    if (n) {
+        memcpy(buf, m_data + m_ptr, n);
+    }
+    m_ptr += n;
+    return n;
+}
+
+int CFileMap::write(const void *, int)
+{
+    return 0;
+}
+
+long CFileMap::getSize()
+{
+    return m_size;
+}
+
+void CFileMap::seek(long p)
+{
+    m_ptr = std::max(0L, std::min(p, m_size));
+}
+
+long CFileMap::tell()
+{
+    return m_ptr;
+}
+
+CFileMap & CFileMap::operator >> (int & n)
+{
+    read(&n, 4);
+    return *this;
+}
+
+CFileMap & CFileMap::operator >> (std::string & str)
+{
+    // length: one byte, 0xff + uint16 or 0xff + 0xffff + uint32
+    uint32_t x = 0;
+    read(&x, 1);
+    if (x == 0xff) {
+        x = 0;
+        read(&x, 2);
+        if (x == 0xffff) {
+            read(&x, 4);
+        }
+    }
+
+    const long left = std::max(0L, m_size - m_ptr);
+    const long size = x < (uint64_t) left ? (long) x : left;
+    str.assign((const char*) m_data + m_ptr, size);
+    m_ptr += size;
+    return *this;
+}
+
+CFileMap & CFileMap::operator >> (bool & b)
+{
+    memset(&b, 0, sizeof(b));
+    read(&b, 1);
+    return *this;
+}
+
+// read-only: the output operators are no-ops
+
+CFileMap & CFileMap::operator << (int)
+{
+    return *this;
+}
+
+CFileMap & CFileMap::operator << (const std::string &)
+{
+    return *this;
+}
+
+CFileMap & CFileMap::operator << (bool)
+{
+    return *this;
+}
+
+CFileMap & CFileMap::operator += (const std::string &)
+{
+    return *this;
+}
+
+CFileMap & CFileMap::operator += (const char *)
+{
+    return *this;
+}
@@ -0,0 +1,74 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <stdint.h>
+#include "IFile.h"
+
+// Read-only IFile backed by a memory mapping. Small files are pulled in
+// with a single read instead, since mapping them costs more than copying.
+// The whole contents are available through data()/span() until close().
+
+class CFileMap : public IFile
+{
+public:
+    CFileMap();
+    virtual ~CFileMap();
+
+    virtual CFileMap &operator>>(std::string &str);
+    virtual CFileMap &operator<<(const std::string &str);
+    virtual CFileMap &operator+=(const std::string &str);
+
+    virtual CFileMap &operator>>(int &n);
+    virtual CFileMap &operator<<(int n);
+
+    virtual CFileMap &operator>>(bool &b);
+    virtual CFileMap &operator<<(bool b);
+    virtual CFileMap &operator+=(const char *);
+
+    virtual bool open(const char *filename, const char *mode = "rb");
+    virtual int read(void *buf, int size);
+    virtual int write(const void *buf, int size);
+
+    virtual void close();
+    virtual long getSize();
+    virtual void seek(long i);
+    virtual long tell();
+
+    virtual const uint8_t *data();
+    std::span<const uint8_t> span() const;
+
+protected:
+    enum
+    {
+        MAP_THRESHOLD = 64 * 1024
+    };
+
+    const uint8_t *m_data;
+    long m_size;
+    long m_ptr;
+    void *m_mapping;
+    std::vector<uint8_t> m_buffer;
+#ifdef _WIN32
+    void *m_handle;
+#endif
+};
@@ -170,9 +170,13 @@ CFileWrap & CFileWrap::operator >> ( std::string & str)
         ++_ptr;
 
         if (x == 0xff) {
+            x = 0;
             memcpy(&x, &m_memFile->data[_ptr], 2);
             _ptr += 2;
-            // TODO: implement 32 bits version
+            if (x == 0xffff) {
+                memcpy(&x, &m_memFile->data[_ptr], 4);
+                _ptr += 4;
+            }
         }
 
         if (x != 0) {
@@ -194,8 +198,9 @@ CFileWrap & CFileWrap::operator >> ( std::string & str)
         fread (&x, 1, 1, m_file);
         if (x == 0xff) {
             fread (&x, 2, 1, m_file);
-
-            // TODO: implement 32 bits version
+            if (x == 0xffff) {
+                fread (&x, 4, 1, m_file);
+            }
         }
 
         if (x != 0) {
@@ -226,9 +231,14 @@ CFileWrap & CFileWrap::operator << (const std::string & str)
         int t = 0xff;
 
         fwrite (&t, 1, 1, m_file);
-        fwrite (&x, 2, 1, m_file);
-
-        // TODO : implement 32bits version
+        if (x < 0xffff) {
+            fwrite (&x, 2, 1, m_file);
+        } else {
+            // 0xffff escapes to a 32 bits length
+            t = 0xffff;
+            fwrite (&t, 2, 1, m_file);
+            fwrite (&x, 4, 1, m_file);
+        }
     }
 
     if (x!=0) {
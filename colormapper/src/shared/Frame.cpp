@@ -30,7 +30,238 @@
 #include "CRC.h"
 #include "IFile.h"
 #include "helper.h"
+#include "PixelPool.h"
+#include "Undo.h"
+#include "PixelOps.h"
+#include "Resampler.h"
 #include <stdint.h>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAME_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // number of pixels with a non-zero alpha among rgb[0..7]
+    inline int countOpaque8(const uint32_t *rgb)
+    {
+#if defined(FRAME_USE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i a = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)rgb), 24);
+        __m128i b = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(rgb + 4)), 24);
+        // a and b fit in 16 bits, so the pack cannot saturate
+        __m128i ab = _mm_packs_epi32(a, b);
+        int clear = _mm_movemask_epi8(_mm_cmpeq_epi16(ab, zero));
+        return 8 - std::popcount((unsigned)clear) / 2;
+#else
+        int count = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            count += (rgb[i] & CFrame::ALPHA_MASK) != 0;
+        }
+        return count;
+#endif
+    }
+
+    enum
+    {
+        ROTATE_TILE = 32,   // 32x32 pixels: a source and a destination tile fit in L1
+        TRANSPOSE_TILE = 8  // both tiles are strided; small enough not to alias in L1
+    };
+
+    // reverse the order of n pixels in place
+    void reversePixels(uint32_t *rgb, size_t n)
+    {
+        size_t i = 0;
+        size_t j = n;
+#ifdef FRAME_USE_SSE2
+        while (j - i >= 8)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(rgb + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(rgb + j - 4));
+            _mm_storeu_si128((__m128i *)(rgb + i), _mm_shuffle_epi32(b, 0x1b));
+            _mm_storeu_si128((__m128i *)(rgb + j - 4), _mm_shuffle_epi32(a, 0x1b));
+            i += 4;
+            j -= 4;
+        }
+#endif
+        std::reverse(rgb + i, rgb + j);
+    }
+
+    // transpose an n x n image in place, one pair of tiles at a time
+    void transposeSquare(uint32_t *rgb, int n)
+    {
+        for (int by = 0; by < n; by += TRANSPOSE_TILE)
+        {
+            const int ey = std::min(by + (int)TRANSPOSE_TILE, n);
+            for (int bx = by; bx < n; bx += TRANSPOSE_TILE)
+            {
+                const int ex = std::min(bx + (int)TRANSPOSE_TILE, n);
+                for (int y = by; y < ey; ++y)
+                {
+                    for (int x = bx == by ? y + 1 : bx; x < ex; ++x)
+                    {
+                        std::swap(rgb[x + y * n], rgb[y + x * n]);
+                    }
+                }
+            }
+        }
+    }
+
+    // dst (hei x len) = src (len x hei) turned 90 degrees clockwise or
+    // counter-clockwise, walking the source tile by tile
+    void rotateTiled(uint32_t *dst, const uint32_t *src, int len, int hei, bool clockwise)
+    {
+        for (int by = 0; by < hei; by += ROTATE_TILE)
+        {
+            const int ey = std::min(by + (int)ROTATE_TILE, hei);
+            for (int bx = 0; bx < len; bx += ROTATE_TILE)
+            {
+                const int ex = std::min(bx + (int)ROTATE_TILE, len);
+                for (int y = by; y < ey; ++y)
+                {
+                    const uint32_t *s = src + y * len;
+                    if (clockwise)
+                    {
+                        for (int x = bx; x < ex; ++x)
+                        {
+                            dst[x * hei + hei - 1 - y] = s[x];
+                        }
+                    }
+                    else
+                    {
+                        for (int x = bx; x < ex; ++x)
+                        {
+                            dst[(len - 1 - x) * hei + y] = s[x];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // scanline flood fill with an explicit seed stack: each popped seed is
+    // widened to a full run, painted, and one seed is pushed per matching
+    // run on the rows above and below. inside() must turn false for pixels
+    // once paint() has been called on them.
+    template <typename INSIDE, typename PAINT>
+    void scanlineFill(int len, int hei, int x, int y, bool diagonal, INSIDE inside, PAINT paint)
+    {
+        const int d = diagonal ? 1 : 0;
+        std::vector<std::pair<int, int>> seeds;
+        seeds.emplace_back(x, y);
+        while (!seeds.empty())
+        {
+            const auto [sx, sy] = seeds.back();
+            seeds.pop_back();
+            if (!inside(sx, sy))
+            {
+                continue;
+            }
+            int lx = sx;
+            while (lx > 0 && inside(lx - 1, sy))
+            {
+                --lx;
+            }
+            int rx = sx;
+            while (rx < len - 1 && inside(rx + 1, sy))
+            {
+                ++rx;
+            }
+            for (int i = lx; i <= rx; ++i)
+            {
+                paint(i, sy);
+            }
+
+            const int x0 = std::max(lx - d, 0);
+            const int x1 = std::min(rx + d, len - 1);
+            for (const int ny : {sy - 1, sy + 1})
+            {
+                if (ny < 0 || ny >= hei)
+                {
+                    continue;
+                }
+                bool run = false;
+                for (int i = x0; i <= x1; ++i)
+                {
+                    const bool in = inside(i, ny);
+                    if (in && !run)
+                    {
+                        seeds.emplace_back(i, ny);
+                    }
+                    run = in;
+                }
+            }
+        }
+    }
+
+    // colour -> palette index lookup for the indexed png encoder
+    // (open addressing, at most 256 colours)
+    class CPaletteIndex
+    {
+    public:
+        enum
+        {
+            MAX_COLORS = 256,
+            SLOTS = 1024
+        };
+
+        CPaletteIndex()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            memset(m_slots, 0, sizeof(m_slots));
+            m_colors.clear();
+        }
+
+        // false once more than MAX_COLORS distinct colours were seen
+        bool add(uint32_t color)
+        {
+            int i = slot(color);
+            if (!m_slots[i])
+            {
+                if ((int)m_colors.size() == MAX_COLORS)
+                {
+                    return false;
+                }
+                m_colors.push_back(color);
+                m_slots[i] = m_colors.size();
+                m_keys[i] = color;
+            }
+            return true;
+        }
+
+        int find(uint32_t color) const
+        {
+            return m_slots[slot(color)] - 1;
+        }
+
+        const std::vector<uint32_t> &colors() const
+        {
+            return m_colors;
+        }
+
+    protected:
+        int slot(uint32_t color) const
+        {
+            int i = (color * 0x9e3779b1u) >> 22;
+            while (m_slots[i] && m_keys[i] != color)
+            {
+                i = (i + 1) & (SLOTS - 1);
+            }
+            return i;
+        }
+
+        uint16_t m_slots[SLOTS]; // index + 1, 0 = empty
+        uint32_t m_keys[SLOTS];
+        std::vector<uint32_t> m_colors;
+    };
+}
 
 /////////////////////////////////////////////////////////////////////////////
 // CFrame
@@ -43,33 +274,32 @@ CFrame::~CFrame()
 /////////////////////////////////////////////////////////////////////////////
 // CFrame message handlers
 
-CFrame::CFrame(int p_nLen, int p_nHei)
+CFrame::CFrame(int p_nLen, int p_nHei, const std::shared_ptr<CPixelPool> &pool)
 {
     m_bCustomMap = false;
     m_nLen = p_nLen;
     m_nHei = p_nHei;
+    m_pool = pool ? pool : CPixelPool::global();
 
     // generate blank bitmap
-    m_rgb = new uint32_t[m_nLen * m_nHei];
-    memset(m_rgb, 0, m_nLen * m_nHei * 4);
-
-    // generate blank map
-    m_map.resize(m_nLen, m_nHei);
-    m_bCustomMap = false;
+    m_rgb = m_pool->alloc(m_nLen * m_nHei);
+    if (m_rgb)
+    {
+        memset(m_rgb, 0, m_nLen * m_nHei * 4);
+    }
 
-    m_undoFrames = nullptr;
-    m_undoSize = 0;
-    m_undoPtr = 0;
+    // the map is built on first use
+    m_mapDirty = true;
 }
 
-CFrame::CFrame(CFrame *src)
+CFrame::CFrame(const CFrame *src)
 {
     if (src)
     {
         m_nHei = src->m_nHei;
         m_nLen = src->m_nLen;
-        m_rgb = new uint32_t[m_nLen * m_nHei];
-        m_map.resize(src->m_nLen, src->m_nHei);
+        m_pool = src->m_pool;
+        m_rgb = m_pool->alloc(m_nLen * m_nHei);
         m_bCustomMap = src->m_bCustomMap;
 
         if (src->m_rgb)
@@ -82,24 +312,80 @@ CFrame::CFrame(CFrame *src)
             memset(m_rgb, 0, m_nLen * m_nHei * sizeof(uint32_t));
         }
 
-        m_map = src->getMap();
+        // share the work only if the source map is current
+        m_mapDirty = src->m_mapDirty.load();
+        if (!m_mapDirty)
+        {
+            m_map = src->m_map;
+        }
     }
     else
     {
         init();
     }
-    // create undo buffer
-    m_undoFrames = nullptr;
-    m_undoSize = 0;
-    m_undoPtr = 0;
+}
+
+CFrame::CFrame(const CFrame &src) : CFrame(&src)
+{
+}
+
+CFrame::CFrame(CFrame &&src) noexcept
+{
+    init();
+    *this = std::move(src);
+}
+
+CFrame::CFrame(const CFrameView &src, const std::shared_ptr<CPixelPool> &pool)
+{
+    m_bCustomMap = false;
+    m_nLen = src.len();
+    m_nHei = src.hei();
+    m_pool = pool ? pool : CPixelPool::global();
+    m_rgb = m_pool->alloc(m_nLen * m_nHei);
+    for (int y = 0; y < m_nHei; ++y)
+    {
+        memcpy(m_rgb + y * m_nLen, src.row(y), m_nLen * sizeof(uint32_t));
+    }
+    m_mapDirty = true;
+}
+
+CFrame &CFrame::operator=(CFrame &&src) noexcept
+{
+    if (this != &src)
+    {
+        forget();
+        swapImage(src);
+        std::swap(m_undo, src.m_undo);
+    }
+    return *this;
+}
+
+void CFrame::swapImage(CFrame &other)
+{
+    std::swap(m_nLen, other.m_nLen);
+    std::swap(m_nHei, other.m_nHei);
+    std::swap(m_rgb, other.m_rgb);
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_bCustomMap, other.m_bCustomMap);
+    m_mapDirty = other.m_mapDirty.exchange(m_mapDirty);
+    m_map.swap(other.m_map);
+}
+
+CFrameView CFrame::view(int mx, int my, int cx, int cy) const
+{
+    return CFrameView(m_rgb, m_nLen, m_nLen, m_nHei).clip(mx, my, cx, cy);
 }
 
 CFrame &CFrame::operator=(const CFrame &src)
 {
+    if (this == &src)
+    {
+        return *this;
+    }
+    releaseRGB();
     m_nHei = src.m_nHei;
     m_nLen = src.m_nLen;
-    m_rgb = new uint32_t[m_nLen * m_nHei];
-    m_map = src.getMap();
+    m_rgb = m_pool->alloc(m_nLen * m_nHei);
     if (src.getRGB())
     {
         memcpy(m_rgb, src.getRGB(), m_nLen * m_nHei * sizeof(uint32_t));
@@ -110,7 +396,11 @@ CFrame &CFrame::operator=(const CFrame &src)
     }
 
     m_bCustomMap = src.m_bCustomMap;
-    m_map = src.getMap();
+    m_mapDirty = src.m_mapDirty.load();
+    if (!m_mapDirty)
+    {
+        m_map = src.m_map;
+    }
 
     return *this;
 }
@@ -120,31 +410,36 @@ void CFrame::init()
     m_nHei = 0;
     m_nLen = 0;
     m_bCustomMap = false;
+    m_mapDirty = true;
     m_rgb = nullptr;
+    m_pool = CPixelPool::global();
 }
 
-void CFrame::forget()
+void CFrame::releaseRGB()
 {
-    if (m_rgb != nullptr)
-    {
-        delete[] m_rgb;
-        m_rgb = nullptr;
-    }
+    m_pool->release(m_rgb, m_nLen * m_nHei);
+    m_rgb = nullptr;
+}
 
-    if (m_undoFrames)
+void CFrame::setRGB(uint32_t *rgb)
+{
+    if (rgb != m_rgb)
     {
-        for (int i = 0; i < m_undoSize; ++i)
-        {
-            delete m_undoFrames[i];
-        }
-        delete[] m_undoFrames;
-        m_undoFrames = nullptr;
-        m_undoSize = 0;
-        m_undoPtr = 0;
+        releaseRGB();
+        m_rgb = rgb;
     }
+    invalidateMap();
+}
+
+void CFrame::forget()
+{
+    releaseRGB();
+
+    m_undo.reset();
 
     m_nLen = 0;
     m_nHei = 0;
+    m_mapDirty = true;
 }
 
 void CFrame::write(IFile &file)
@@ -173,7 +468,7 @@ void CFrame::write(IFile &file)
 
         if (m_bCustomMap)
         {
-            m_map.write(file);
+            getMap().write(file);
         }
     }
 }
@@ -181,11 +476,7 @@ void CFrame::write(IFile &file)
 bool CFrame::read(IFile &file, int version)
 {
     // clear existing bitmap and map
-    if (m_rgb)
-    {
-        delete[] m_rgb;
-        m_rgb = nullptr;
-    }
+    releaseRGB();
 
     m_nLen = 0;
     m_nHei = 0;
@@ -211,7 +502,7 @@ bool CFrame::read(IFile &file, int version)
             uLong nDestLen = m_nLen * m_nHei * 4;
 
             // create a new bitmap
-            m_rgb = new uint32_t[m_nLen * m_nHei];
+            m_rgb = m_pool->alloc(m_nLen * m_nHei);
 
             int err = uncompress(
                 (uint8_t *)m_rgb,
@@ -226,15 +517,15 @@ bool CFrame::read(IFile &file, int version)
                 return false;
             }
 
-            // create a new map
-            m_map.resize(m_nLen, m_nHei);
             if (m_bCustomMap)
             {
+                m_map.resize(m_nLen, m_nHei);
                 m_map.read(file);
+                m_mapDirty = false;
             }
             else
             {
-                updateMap();
+                invalidateMap();
             }
         }
     }
@@ -328,27 +619,82 @@ uint32_t CFrame::toNet(const uint32_t a)
     return b;
 }
 
-void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5size)
+void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5size, const pngOptions_t &options)
 {
     CCRC crc;
 
+    // count the colours; 256 or fewer are written as an indexed image
+    // unless the palette would outweigh the pixels (tiny frames)
+    CPaletteIndex index;
+    bool indexed = options.palette && m_nLen && m_nHei;
+    uint32_t last = indexed ? ~m_rgb[0] : 0;
+    for (int i = 0; indexed && i < m_nLen * m_nHei; ++i)
+    {
+        if (m_rgb[i] != last)
+        {
+            last = m_rgb[i];
+            indexed = index.add(last);
+        }
+    }
+
+    // translucent entries go first so that tRNS can stop at the last one
+    std::vector<uint32_t> palette;
+    int trnsSize = 0;
+    int depth = 8;
+    if (indexed)
+    {
+        palette = index.colors();
+        std::stable_partition(palette.begin(), palette.end(), [](uint32_t c) {
+            return (c & ALPHA_MASK) != ALPHA_MASK;
+        });
+        index.clear();
+        for (uint32_t color : palette)
+        {
+            index.add(color);
+            trnsSize += (color & ALPHA_MASK) != ALPHA_MASK;
+        }
+        int count = palette.size();
+        indexed = count * 4 <= m_nLen * m_nHei;
+        if (indexed)
+        {
+            depth = count <= 2 ? 1 : (count <= 4 ? 2 : (count <= 16 ? 4 : 8));
+        }
+    }
+
     // compress the data ....................................
-    int scanLine = m_nLen * 4;
+    int scanLine = indexed ? (m_nLen * depth + 7) / 8 : m_nLen * 4;
     uLong dataSize = (scanLine + 1) * m_nHei;
     uint8_t *data = new uint8_t[dataSize];
-    for (int y = 0; y < m_nHei; ++y)
-    {
+    std::vector<uint8_t> zero(scanLine, 0);
+    parallelFor(m_nHei, [&](int y) {
         uint8_t *d = data + y * (scanLine + 1);
-        *d = 0;
-        memcpy(d + 1, m_rgb + y * m_nLen, scanLine);
-    }
+        if (indexed)
+        {
+            // the spec recommends no filtering for palette images
+            *d++ = PNG_FILTER_NONE;
+            memset(d, 0, scanLine);
+            const uint32_t *rgb = m_rgb + y * m_nLen;
+            for (int x = 0; x < m_nLen; ++x)
+            {
+                int bit = x * depth;
+                d[bit >> 3] |= index.find(rgb[x]) << (8 - depth - (bit & 7));
+            }
+            return;
+        }
+        const uint8_t *row = (const uint8_t *)(m_rgb + y * m_nLen);
+        const uint8_t *prior = y ? (const uint8_t *)(m_rgb + (y - 1) * m_nLen) : zero.data();
+        *d = pngSelectFilter(options.filter, d + 1, row, prior, scanLine, 4);
+    }, options.threads);
 
     uint8_t *cData;
     uLong cDataSize;
-    int err = compressData(data, dataSize, &cData, cDataSize);
+    int err = compressDataParallel(data, dataSize, &cData, cDataSize, options.level, options.threads);
     if (err != Z_OK)
     {
         printf("CFrame::toPng error: %d\n", err);
+        delete[] data;
+        png = nullptr;
+        totalSize = 0;
         return;
     }
 
@@ -361,6 +707,10 @@ void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5siz
     }
 
     totalSize = pngHeaderSize + png_IHDR_Size + 4 + cDataSize + 12 * cDataBlocks + sizeof(png_IEND) + obl5size;
+    if (indexed)
+    {
+        totalSize += 12 + 3 * palette.size() + (trnsSize ? 12 + trnsSize : 0);
+    }
 
     png = new uint8_t[totalSize];
     uint8_t *t = png;
@@ -378,8 +728,8 @@ void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5siz
     memcpy(ihdr.ChunkType, "IHDR", 4);
     ihdr.Width = toNet(m_nLen);
     ihdr.Height = toNet(m_nHei);
-    ihdr.BitDepth = 8;
-    ihdr.ColorType = 6;
+    ihdr.BitDepth = depth;
+    ihdr.ColorType = indexed ? 3 : 6;
     ihdr.Compression = 0; // deflated
     ihdr.Filter = 0;
     ihdr.Interlace = 0;
@@ -389,6 +739,34 @@ void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5siz
     memcpy(t, &crc32, 4);
     t += 4;
 
+    // png_PLTE / png_tRNS .........................................
+    if (indexed)
+    {
+        auto writeChunk = [&](const char *type, const uint8_t *buf, int size) {
+            uint32_t v = toNet(size);
+            memcpy(t, &v, 4);
+            memcpy(t + 4, type, 4);
+            memcpy(t + 8, buf, size);
+            v = toNet(crc.crc(t + 4, size + 4));
+            memcpy(t + 8 + size, &v, 4);
+            t += 12 + size;
+        };
+        std::vector<uint8_t> plte;
+        std::vector<uint8_t> trns;
+        for (uint32_t color : palette)
+        {
+            plte.push_back(color & 0xff);
+            plte.push_back((color >> 8) & 0xff);
+            plte.push_back((color >> 16) & 0xff);
+            trns.push_back(color >> 24);
+        }
+        writeChunk("PLTE", plte.data(), plte.size());
+        if (trnsSize)
+        {
+            writeChunk("tRNS", trns.data(), trnsSize);
+        }
+    }
+
     // png_IDAT ....................................................
     uint32_t cDataOffset = 0;
     uint32_t cDataLeft = cDataSize;
@@ -442,39 +820,27 @@ void CFrame::toPng(uint8_t *&png, int &totalSize, uint8_t *obl5data, int obl5siz
 
 void CFrame::resize(int len, int hei)
 {
-    CFrame *newFrame = new CFrame(len, hei);
+    uint32_t *rgb = m_pool->alloc(len * hei);
+    memset(rgb, 0, len * hei * sizeof(uint32_t));
 
     // Copy the original frame
     for (int y = 0; y < std::min(hei, m_nHei); ++y)
     {
-        for (int x = 0; x < std::min(len, m_nLen); ++x)
-        {
-            newFrame->at(x, y) = at(x, y);
-        }
+        memcpy(rgb + y * len, &at(0, y), std::min(len, m_nLen) * sizeof(uint32_t));
     }
 
-    delete[] m_rgb;
-    m_rgb = newFrame->getRGB();
-    newFrame->detach();
-    delete newFrame;
+    releaseRGB();
+    m_rgb = rgb;
 
     m_nLen = len;
     m_nHei = hei;
-
-    // TODO: actually resize the map
-    m_map.resize(m_nLen, m_nHei);
+    invalidateMap();
 }
 
 void CFrame::setTransparency(uint32_t color)
 {
-    color &= COLOR_MASK;
-    for (int i = 0; i < m_nLen * m_nHei; ++i)
-    {
-        if ((m_rgb[i] & COLOR_MASK) == color)
-        {
-            m_rgb[i] = 0;
-        }
-    }
+    pixelClearColor(m_rgb, m_nLen * m_nHei, color);
+    invalidateMap();
 }
 
 void CFrame::setTopPixelAsTranparency()
@@ -484,74 +850,84 @@ void CFrame::setTopPixelAsTranparency()
 
 void CFrame::updateMap()
 {
-    m_map.resize(m_nLen, m_nHei);
-    int threhold = CSS3Map::GRID * CSS3Map::GRID / 4;
-    for (int y = 0; y < m_map.height(); ++y)
+    buildMap();
+}
+
+void CFrame::buildMap() const
+{
+    static_assert(CSS3Map::GRID == 8, "countOpaque8 assumes 8 pixel cells");
+    enum
     {
-        for (int x = 0; x < m_map.length(); ++x)
+        PARALLEL_MIN_PIXELS = 512 * 512
+    };
+
+    m_map.resize(m_nLen, m_nHei);
+    const int threhold = CSS3Map::GRID * CSS3Map::GRID / 4;
+    const int cells = m_map.length();
+    const int threads = m_nLen * m_nHei >= PARALLEL_MIN_PIXELS ? 0 : 1;
+
+    // each band is one row of cells, scanned row-major
+    parallelFor(m_map.height(), [&](int cy) {
+        std::vector<uint8_t> counts(cells, 0);
+        for (int j = 0; j < CSS3Map::GRID; ++j)
         {
-            int data = 0;
-            for (int i = 0; i < CSS3Map::GRID; ++i)
-            {
-                for (int j = 0; j < CSS3Map::GRID; ++j)
-                {
-                    data += ((point(x * CSS3Map::GRID + i, y * CSS3Map::GRID + j)) & ALPHA_MASK) != 0;
-                }
-            }
-            if (data >= threhold)
-            {
-                m_map.at(x, y) = 0xff;
-            }
-            else
+            const uint32_t *row = m_rgb + (cy * CSS3Map::GRID + j) * m_nLen;
+            for (int cx = 0; cx < cells; ++cx)
             {
-                m_map.at(x, y) = 0;
+                counts[cx] += countOpaque8(row + cx * CSS3Map::GRID);
             }
         }
-    }
+        char *out = &m_map.at(0, cy);
+        for (int cx = 0; cx < cells; ++cx)
+        {
+            out[cx] = counts[cx] >= threhold ? 0xff : 0;
+        }
+    }, threads);
+    m_mapDirty = false;
 }
 
 bool CFrame::hasTransparency() const
 {
-    for (int i = 0; i < m_nLen * m_nHei; ++i)
+    return pixelAnyTransparent(m_rgb, m_nLen * m_nHei);
+}
+
+CFrameSet *CFrame::split(int pxSize, bool whole)
+{
+    CFrameSet *frameSet = new CFrameSet();
+    for (const CFrameView &tile : tiles(pxSize))
     {
-        if (!(m_rgb[i] & ALPHA_MASK))
+        CFrame *frame;
+        if (whole)
         {
-            return true;
+            // edge tiles are padded with transparent pixels
+            frame = new CFrame(pxSize, pxSize, frameSet->pool());
+            frame->drawAt(tile, 0, 0, false);
+        }
+        else
+        {
+            frame = new CFrame(tile, frameSet->pool());
         }
+        frameSet->add(frame);
     }
-
-    return false;
+    return frameSet;
 }
 
-CFrameSet *CFrame::split(int pxSize, bool whole)
+std::vector<CFrameView> CFrame::tiles(int pxSize) const
 {
-    CFrameSet *frameSet = new CFrameSet();
+    std::vector<CFrameView> tiles;
+    if (pxSize < 1)
+    {
+        return tiles;
+    }
+    tiles.reserve(((m_nLen + pxSize - 1) / pxSize) * ((m_nHei + pxSize - 1) / pxSize));
     for (int y = 0; y < m_nHei; y += pxSize)
     {
         for (int x = 0; x < m_nLen; x += pxSize)
         {
-            CFrame *frame;
-            if (whole)
-            {
-                frame = new CFrame(pxSize, pxSize);
-            }
-            else
-            {
-                frame = new CFrame(std::min(pxSize, m_nLen - x), std::min(pxSize, m_nHei - y));
-            }
-            uint32_t *ni_rgb = frame->getRGB();
-            for (int z = 0; z < std::min(pxSize, m_nHei - y); ++z)
-            {
-                memcpy(&ni_rgb[z * frame->m_nLen], // pxSize],
-                       &m_rgb[x + (y + z) * m_nLen],
-                       std::min(pxSize, m_nLen - x) * sizeof(uint32_t));
-            }
-            frameSet->add(frame);
-            // TODO: copy the actual map
-            frame->updateMap();
+            tiles.push_back(view(x, y, pxSize, pxSize));
         }
     }
-    return frameSet;
+    return tiles;
 }
 
 const uint32_t *CFrame::dosPal()
@@ -640,6 +1016,10 @@ bool CFrame::draw(CDotArray *dots, int size, int mode)
             }
         }
     }
+    if (changed)
+    {
+        invalidateMap();
+    }
     return changed;
 }
 
@@ -663,89 +1043,71 @@ void CFrame::save(CDotArray *dots, CDotArray *dotsOrg, int size)
 
 void CFrame::floodFill(int x, int y, uint32_t bOldColor, uint32_t bNewColor)
 {
-    if (!isValid(x, y))
-    {
-        return;
-    }
-
-    int ex = x;
-    for (; (x >= 0) && at(x, y) == bOldColor; --x)
-    {
-        at(x, y) = bNewColor;
-        if ((y > 0) && (at(x, y - 1) == bOldColor))
-        {
-            floodFill(x, y - 1, bOldColor, bNewColor);
-        }
-
-        if ((y < m_nHei - 1) && (at(x, y + 1) == bOldColor))
-        {
-            floodFill(x, y + 1, bOldColor, bNewColor);
-        }
-    }
-
-    x = ++ex;
-    if (!isValid(x, y))
-    {
-        return;
-    }
-
-    for (; (x < m_nLen) && at(x, y) == bOldColor; ++x)
-    {
-        at(x, y) = bNewColor;
-        if ((y > 0) && (at(x, y - 1) == bOldColor))
-        {
-            floodFill(x, y - 1, bOldColor, bNewColor);
-        }
-
-        if ((y < m_nHei - 1) && (at(x, y + 1) == bOldColor))
-        {
-            floodFill(x, y + 1, bOldColor, bNewColor);
-        }
-    }
+    floodFill(x, y, bOldColor, bNewColor, fillOptions_t());
 }
 
 void CFrame::floodFillAlpha(int x, int y, uint8_t oldAlpha, uint8_t newAlpha)
+{
+    fillOptions_t options;
+    options.alphaOnly = true;
+    floodFill(x, y, (uint32_t)oldAlpha << 24, (uint32_t)newAlpha << 24, options);
+}
+
+void CFrame::floodFill(int x, int y, uint32_t target, uint32_t color, const fillOptions_t &options)
 {
     if (!isValid(x, y))
     {
         return;
     }
 
-    int ex = x;
-    for (; (x >= 0) && alphaAt(x, y) == oldAlpha; --x)
-    {
-        uint8_t *p = (uint8_t *)&point(x, y);
-        p[3] = newAlpha;
-        if ((y > 0) && (alphaAt(x, y - 1) == oldAlpha))
+    const uint32_t mask = options.alphaOnly ? static_cast<uint32_t>(ALPHA_MASK) : 0xffffffff;
+    const int tolerance = std::max(options.tolerance, 0);
+    auto matches = [mask, tolerance, target](uint32_t rgba) {
+        const uint32_t diff = (rgba ^ target) & mask;
+        if (!diff || !tolerance)
         {
-            floodFillAlpha(x, y - 1, oldAlpha, newAlpha);
+            return !diff;
         }
-
-        if ((y < m_nHei - 1) && (alphaAt(x, y + 1) == oldAlpha))
+        for (int shift = 0; shift < 32; shift += 8)
         {
-            floodFillAlpha(x, y + 1, oldAlpha, newAlpha);
+            if (((mask >> shift) & 0xff) && std::abs((int)((rgba >> shift) & 0xff) - (int)((target >> shift) & 0xff)) > tolerance)
+            {
+                return false;
+            }
         }
-    }
+        return true;
+    };
 
-    x = ++ex;
-    if (!isValid(x, y))
+    const uint32_t paint = color & mask;
+    if (!matches(at(x, y)))
     {
         return;
     }
-
-    for (; (x < m_nLen) && alphaAt(x, y) == oldAlpha; ++x)
+    invalidateMap();
+    uint32_t *rgb = m_rgb;
+    const int len = m_nLen;
+    if (!tolerance)
     {
-        uint8_t *p = (uint8_t *)&point(x, y);
-        p[3] = newAlpha;
-        if ((y > 0) && (alphaAt(x, y - 1) == oldAlpha))
-        {
-            floodFillAlpha(x, y - 1, oldAlpha, newAlpha);
-        }
-
-        if ((y < m_nHei - 1) && (alphaAt(x, y + 1) == oldAlpha))
+        // painted pixels stop matching unless nothing changes at all
+        if (paint == (target & mask))
         {
-            floodFillAlpha(x, y + 1, oldAlpha, newAlpha);
+            return;
         }
+        scanlineFill(len, m_nHei, x, y, options.diagonal,
+            [&](int px, int py) { return ((rgb[px + py * len] ^ target) & mask) == 0; },
+            [&](int px, int py) { uint32_t &c = rgb[px + py * len]; c = (c & ~mask) | paint; });
+    }
+    else
+    {
+        // painted pixels may still be within tolerance: track them
+        std::vector<uint8_t> done(len * m_nHei, 0);
+        scanlineFill(len, m_nHei, x, y, options.diagonal,
+            [&](int px, int py) { return !done[px + py * len] && matches(rgb[px + py * len]); },
+            [&](int px, int py) {
+                uint32_t &c = rgb[px + py * len];
+                c = (c & ~mask) | paint;
+                done[px + py * len] = 1;
+            });
     }
 }
 
@@ -771,16 +1133,10 @@ CFrame *CFrame::clip(int mx, int my, int cx, int cy)
     }
 
     // create clipped frame
-    CFrame *t = new CFrame(cx, cy);
+    CFrame *t = new CFrame(cx, cy, m_pool);
 
-    // copy clipped region
-    for (int y = 0; y < cy; ++y)
-    {
-        for (int x = 0; x < cx; ++x)
-        {
-            t->at(x, y) = at(mx + x, my + y);
-        }
-    }
+    // copy the part of the region that lies within this frame
+    t->drawAt(view(mx, my, cx, cy), std::max(-mx, 0), std::max(-my, 0), false);
 
     // return new frame
     return t;
@@ -796,62 +1152,74 @@ void CFrame::clear()
         }
     }
 
-    // TODO: updatemap
+    invalidateMap();
 }
 
 void CFrame::flipV()
 {
     for (int y = 0; y < m_nHei / 2; ++y)
     {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            uint32_t c = at(x, y);
-            at(x, y) = at(x, m_nHei - y - 1);
-            at(x, m_nHei - y - 1) = c;
-        }
+        std::swap_ranges(&at(0, y), &at(0, y) + m_nLen, &at(0, m_nHei - y - 1));
     }
-    // TODO: updatemap
+    invalidateMap();
 }
 
 void CFrame::flipH()
 {
     for (int y = 0; y < m_nHei; ++y)
     {
-        for (int x = 0; x < m_nLen / 2; ++x)
-        {
-            uint32_t c = at(x, y);
-            at(x, y) = at(m_nLen - x - 1, y);
-            at(m_nLen - x - 1, y) = c;
-        }
+        reversePixels(&at(0, y), m_nLen);
     }
-    // TODO: updatemap
+    invalidateMap();
 }
 
 void CFrame::rotate()
 {
-    CFrame *newFrame = new CFrame(m_nHei, m_nLen);
-    for (int y = 0; y < m_nHei; ++y)
+    rotate(90);
+}
+
+void CFrame::rotate(int degrees)
+{
+    degrees = ((degrees % 360) + 360) % 360;
+    if (!m_rgb || !degrees || degrees % 90)
     {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            newFrame->at(newFrame->m_nLen - y - 1, x) = at(x, y);
-        }
+        return;
     }
 
-    m_nLen = newFrame->m_nLen;
-    m_nHei = newFrame->m_nHei;
-    delete[] m_rgb;
-    m_rgb = newFrame->getRGB();
+    if (degrees == 180)
+    {
+        reversePixels(m_rgb, m_nLen * m_nHei);
+        invalidateMap();
+        return;
+    }
 
-    newFrame->detach();
-    delete newFrame;
+    const bool clockwise = degrees == 90;
+    if (m_nLen == m_nHei)
+    {
+        // square frames turn in place
+        transposeSquare(m_rgb, m_nLen);
+        if (clockwise)
+        {
+            flipH();
+        }
+        else
+        {
+            flipV();
+        }
+        return;
+    }
 
-    // TODO: updatemap
+    uint32_t *rgb = m_pool->alloc(m_nLen * m_nHei);
+    rotateTiled(rgb, m_rgb, m_nLen, m_nHei, clockwise);
+    releaseRGB();
+    m_rgb = rgb;
+    std::swap(m_nLen, m_nHei);
+    invalidateMap();
 }
 
 void CFrame::spreadH()
 {
-    uint32_t *rgb = new uint32_t[m_nLen * m_nHei * 2];
+    uint32_t *rgb = m_pool->alloc(m_nLen * m_nHei * 2);
 
     for (int y = 0; y < m_nHei; ++y)
     {
@@ -864,16 +1232,16 @@ void CFrame::spreadH()
                m_nLen * sizeof(uint32_t));
     }
 
-    m_nLen *= 2;
-    delete[] m_rgb;
+    releaseRGB();
     m_rgb = rgb;
+    m_nLen *= 2;
 
-    // TODO: updatemap
+    invalidateMap();
 }
 
 void CFrame::spreadV()
 {
-    uint32_t *rgb = new uint32_t[m_nLen * m_nHei * 2];
+    uint32_t *rgb = m_pool->alloc(m_nLen * m_nHei * 2);
 
     for (int y = 0; y < m_nHei; ++y)
     {
@@ -886,177 +1254,142 @@ void CFrame::spreadV()
                m_nLen * sizeof(uint32_t));
     }
 
-    m_nHei *= 2;
-    delete[] m_rgb;
+    releaseRGB();
     m_rgb = rgb;
+    m_nHei *= 2;
 
-    // TODO: updatemap
+    invalidateMap();
 }
 
 void CFrame::shrink()
 {
-    CFrame *newFrame = new CFrame(m_nLen / 2, m_nHei / 2);
-    for (int y = 0; y < m_nHei / 2; ++y)
+    scale(m_nLen / 2, m_nHei / 2, RESAMPLE_NEAREST);
+}
+
+void CFrame::scale(int len, int hei, int filter)
+{
+    if (!m_rgb || len < 1 || hei < 1)
     {
-        for (int x = 0; x < m_nLen / 2; ++x)
-        {
-            newFrame->at(x, y) = at(x * 2, y * 2);
-        }
+        return;
     }
 
-    // why wasn't the old rgb deleted?
-    if (m_rgb)
+    uint32_t *rgb = m_pool->alloc(len * hei);
+    if (!resample(m_rgb, m_nLen, m_nLen, m_nHei, rgb, len, len, hei, filter))
     {
-        delete m_rgb;
+        m_pool->release(rgb, len * hei);
+        return;
     }
-    m_rgb = newFrame->getRGB();
-    newFrame->detach();
-    delete newFrame;
-
-    m_nLen /= 2;
-    m_nHei /= 2;
-
-    // TODO: actually resize the map
-    m_map.resize(m_nLen, m_nHei);
 
-    // TODO: fix this temp updateMap
-    updateMap();
+    releaseRGB();
+    m_rgb = rgb;
+    m_nLen = len;
+    m_nHei = hei;
+    invalidateMap();
 }
 
 const CSS3Map &CFrame::getMap() const
 {
-    return m_map;
-}
-
-void CFrame::enlarge()
-{
-    CFrame *newFrame = new CFrame(m_nLen * 2, m_nHei * 2);
-    for (int y = 0; y < m_nHei; ++y)
+    // concurrent readers: the first one in builds the map, the others wait
+    if (m_mapDirty.load(std::memory_order_acquire))
     {
-        for (int x = 0; x < m_nLen; ++x)
+        std::lock_guard<std::mutex> lock(m_mapMutex);
+        if (m_mapDirty.load(std::memory_order_relaxed))
         {
-            uint32_t c = at(x, y);
-            newFrame->at(x * 2, y * 2) = c;
-            newFrame->at(x * 2 + 1, y * 2) = c;
-            newFrame->at(x * 2, y * 2 + 1) = c;
-            newFrame->at(x * 2 + 1, y * 2 + 1) = c;
+            buildMap();
         }
     }
+    return m_map;
+}
 
-    m_rgb = newFrame->getRGB();
-    newFrame->detach();
-    delete newFrame;
-
-    m_nLen *= 2;
-    m_nHei *= 2;
-
-    // TODO: actually resize the map
-    m_map.resize(m_nLen, m_nHei);
-
-    // TODO: fix this temp updateMap
-    updateMap();
+void CFrame::enlarge()
+{
+    scale(m_nLen * 2, m_nHei * 2, RESAMPLE_NEAREST);
 }
 
 void CFrame::shiftUP(const bool wrap)
 {
-    uint32_t *t = new uint32_t[m_nLen];
+    if (m_nLen < 1 || m_nHei < 1)
+    {
+        return;
+    }
 
     // copy first line to buffer
-    memcpy(t, m_rgb, sizeof(uint32_t) * m_nLen);
+    std::vector<uint32_t> t(m_rgb, m_rgb + m_nLen);
 
-    // shift
-    for (int y = 0; y < m_nHei - 1; ++y)
-    {
-        memcpy(&at(0, y), &at(0, y + 1), m_nLen * sizeof(uint32_t));
-    }
+    // shift every other line in one move
+    memmove(m_rgb, &at(0, 1), (m_nHei - 1) * m_nLen * sizeof(uint32_t));
 
     // copy first line to last
     if (wrap)
-        memcpy(&at(0, m_nHei - 1), t, sizeof(uint32_t) * m_nLen);
+        memcpy(&at(0, m_nHei - 1), t.data(), sizeof(uint32_t) * m_nLen);
     else
         memset(&at(0, m_nHei - 1), 0, sizeof(uint32_t) * m_nLen);
 
-    delete[] t;
+    invalidateMap();
 }
 
 void CFrame::shiftDOWN(const bool wrap)
 {
-    uint32_t *t = new uint32_t[m_nLen];
-
-    // copy first line to buffer
-    memcpy(t, &at(0, m_nHei - 1), sizeof(uint32_t) * m_nLen);
-
-    // shift
-    for (int y = 0; y < m_nHei - 1; ++y)
+    if (m_nLen < 1 || m_nHei < 1)
     {
-        memcpy(&at(0, m_nHei - y - 1), &at(0, m_nHei - y - 2), m_nLen * sizeof(uint32_t));
+        return;
     }
 
-    // copy first line to last
+    // copy last line to buffer
+    std::vector<uint32_t> t(&at(0, m_nHei - 1), &at(0, m_nHei - 1) + m_nLen);
+
+    // shift every other line in one move
+    memmove(&at(0, 1), m_rgb, (m_nHei - 1) * m_nLen * sizeof(uint32_t));
+
+    // copy last line to first
     if (wrap)
-        memcpy(m_rgb, t, sizeof(uint32_t) * m_nLen);
+        memcpy(m_rgb, t.data(), sizeof(uint32_t) * m_nLen);
     else
         memset(m_rgb, 0, sizeof(uint32_t) * m_nLen);
-    delete[] t;
+    invalidateMap();
 }
 
 void CFrame::shiftLEFT(const bool wrap)
 {
+    if (m_nLen < 1)
+    {
+        return;
+    }
     for (int y = 0; y < m_nHei; ++y)
     {
-        const uint32_t c = at(0, y);
-        for (int x = 0; x < m_nLen - 1; ++x)
-        {
-            at(x, y) = at(x + 1, y);
-        }
-        if (wrap)
-            at(m_nLen - 1, y) = c;
-        else
-            at(m_nLen - 1, y) = 0;
+        uint32_t *row = &at(0, y);
+        const uint32_t c = row[0];
+        memmove(row, row + 1, (m_nLen - 1) * sizeof(uint32_t));
+        row[m_nLen - 1] = wrap ? c : 0;
     }
+    invalidateMap();
 }
 
 void CFrame::shiftRIGHT(const bool wrap)
 {
+    if (m_nLen < 1)
+    {
+        return;
+    }
     for (int y = 0; y < m_nHei; ++y)
     {
-        const uint32_t c = at(m_nLen - 1, y);
-        for (int x = 0; x < m_nLen - 1; ++x)
-        {
-            at(m_nLen - 1 - x, y) = at(m_nLen - 2 - x, y);
-        }
-        if (wrap)
-            at(0, y) = c;
-        else
-            at(0, y) = 0;
+        uint32_t *row = &at(0, y);
+        const uint32_t c = row[m_nLen - 1];
+        memmove(row + 1, row, (m_nLen - 1) * sizeof(uint32_t));
+        row[0] = wrap ? c : 0;
     }
+    invalidateMap();
 }
 
 bool CFrame::isEmpty() const
 {
-    for (int y = 0; y < m_nHei; ++y)
-    {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            if ((m_rgb[x + y * m_nLen] & 0xff000000))
-            {
-                return false;
-            }
-        }
-    }
-    return true;
+    return !pixelAnyOpaque(m_rgb, m_nLen * m_nHei);
 }
 
 void CFrame::inverse()
 {
-    for (int y = 0; y < m_nHei; ++y)
-    {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            unsigned int &rgb = at(x, y);
-            rgb = (~rgb & 0xffffff) + (rgb & 0xff000000);
-        }
-    }
+    pixelInverse(m_rgb, m_nLen * m_nHei);
+    invalidateMap();
 }
 
 void CFrame::copy(CFrame *frame)
@@ -1066,103 +1399,77 @@ void CFrame::copy(CFrame *frame)
 
 void CFrame::undo()
 {
-    if (m_undoPtr < m_undoSize)
+    if (m_undo)
     {
-        CFrame *tmp = m_undoFrames[m_undoPtr];
-        m_undoFrames[m_undoPtr] = new CFrame(this);
-        copy(tmp);
-        delete tmp;
-        m_undoPtr++;
+        m_undo->undo(*this);
     }
 }
 
 void CFrame::redo()
 {
-    if (m_undoPtr && m_undoSize)
+    if (m_undo)
     {
-        CFrame *tmp = m_undoFrames[m_undoPtr - 1];
-        m_undoFrames[m_undoPtr - 1] = new CFrame(this);
-        copy(tmp);
-        delete tmp;
-        m_undoPtr--;
+        m_undo->redo(*this);
     }
 }
 
 void CFrame::push()
 {
-    if (!m_undoFrames)
-    {
-        m_undoFrames = new CFrame *[MAX_UNDO];
-        m_undoPtr = 0;
-        m_undoSize = 0;
-    }
-
-    if (m_undoPtr != 0)
-    {
-        for (int i = 0; i < m_undoPtr; ++i)
-        {
-            delete m_undoFrames[i];
-        }
-
-        for (int i = 0; i + m_undoPtr < m_undoSize; ++i)
-        {
-            m_undoFrames[i] = m_undoFrames[m_undoPtr + i];
-        }
-        m_undoSize -= m_undoPtr;
-        m_undoPtr = 0;
-    }
-
-    if (m_undoSize == MAX_UNDO)
-    {
-        delete m_undoFrames[m_undoSize - 1];
-    }
-
-    // push everything back
-    for (int i = std::min(m_undoSize, (int)MAX_UNDO - 1); i > 0; --i)
-    {
-        m_undoFrames[i] = m_undoFrames[i - 1];
-    }
-
-    if (m_undoSize < MAX_UNDO)
+    if (!m_undo)
     {
-        ++m_undoSize;
+        m_undo = std::make_unique<CUndo>();
     }
-
-    m_undoFrames[0] = new CFrame(this);
+    m_undo->push(*this);
 }
 
 bool CFrame::canUndo()
 {
-    return m_undoFrames != nullptr && m_undoPtr < m_undoSize;
+    return m_undo && m_undo->canUndo();
 }
 
 bool CFrame::canRedo()
 {
-    return m_undoFrames != nullptr && m_undoPtr > 0 && m_undoSize;
+    return m_undo && m_undo->canRedo();
+}
+
+void CFrame::setUndoBudget(size_t budget)
+{
+    if (!m_undo)
+    {
+        m_undo = std::make_unique<CUndo>(budget);
+    }
+    else
+    {
+        m_undo->setBudget(budget);
+    }
 }
 
 void CFrame::shadow(int factor)
 {
-    for (int y = 0; y < m_nHei; ++y)
+    if (factor <= 0)
     {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            unsigned int &rgb = at(x, y);
-            rgb = (rgb & 0xffffff) + (rgb & 0xff000000) / factor;
-        }
+        return;
+    }
+    // alpha / factor
+    uint8_t lut[256];
+    for (int a = 0; a < 256; ++a)
+    {
+        lut[a] = a / factor;
     }
+    pixelMapAlpha(m_rgb, m_nLen * m_nHei, lut);
+    invalidateMap();
 }
 
 void CFrame::fade(int factor)
 {
-    for (int y = 0; y < m_nHei; ++y)
+    // alpha * factor / 255
+    uint8_t lut[256];
+    for (int a = 0; a < 256; ++a)
     {
-        for (int x = 0; x < m_nLen; ++x)
-        {
-            unsigned int &rgb = at(x, y);
-            rgb = (rgb & 0xffffff) + ((((rgb & 0xff000000) >> 24) * factor / 255) << 24);
-        }
+        lut[a] = std::max(a * factor / 255, 0);
     }
+    pixelMapAlpha(m_rgb, m_nLen * m_nHei, lut);
+    invalidateMap();
 }
 
 CFrameSet *CFrame::explode(int count, short *xx, short *yy, CFrameSet *set)
@@ -1176,7 +1483,6 @@ CFrameSet *CFrame::explode(int count, short *xx, short *yy, CFrameSet *set)
     for (int i = 0; i < count; ++i)
     {
         CFrame *frame = clip(mx, 0, xx[i], yy[i]);
-        frame->updateMap();
         set->add(frame);
         mx += xx[i];
     }
@@ -1186,51 +1492,32 @@ CFrameSet *CFrame::explode(int count, short *xx, short *yy, CFrameSet *set)
 void CFrame::abgr2argb()
 {
     // swap blue/red
-    for (int i = 0; i < m_nLen * m_nHei; ++i)
-    {
-        uint32_t t = (m_rgb[i] & 0xff00ff00);
-        if (t & 0xff000000)
-        {
-            t += ((m_rgb[i] & 0xff) << 16) + ((m_rgb[i] & 0xff0000) >> 16);
-        }
-        m_rgb[i] = t;
-    }
+    pixelSwapRB(m_rgb, m_nLen * m_nHei);
 }
 
 void CFrame::argb2arbg()
 {
     // swap green/blue
-    for (int i = 0; i < m_nLen * m_nHei; ++i)
-    {
-        uint32_t t = (m_rgb[i] & 0xff0000ff);
-        if (t & 0xff000000)
-        {
-            t += ((m_rgb[i] & 0xff00) << 8) + ((m_rgb[i] & 0xff0000) >> 8);
-        }
-        m_rgb[i] = t;
-    }
+    pixelSwapGB(m_rgb, m_nLen * m_nHei);
 }
 
 CFrame *CFrame::toAlphaGray(int mx, int my, int cx, int cy)
 {
-    CFrame *frame;
-
-    if (mx != 0 || my != 0 || cx != -1 || cy != -1)
-    {
-        frame = this->clip(mx, my, cx, cy);
-    }
-    else
-    {
-        frame = new CFrame(this);
-    }
+    return toAlphaGray(view(mx, my, cx, cy), m_pool);
+}
 
-    for (int i = 0; i < frame->m_nLen * frame->m_nHei; ++i)
+CFrame *CFrame::toAlphaGray(const CFrameView &src, const std::shared_ptr<CPixelPool> &pool)
+{
+    CFrame *frame = new CFrame(src.len(), src.hei(), pool);
+    for (int y = 0; y < src.hei(); ++y)
     {
-        unsigned char *p = (unsigned char *)(frame->m_rgb + i);
-        p[0] = p[3];
-        p[1] = p[3];
-        p[2] = p[3];
-        p[3] = 0xff;
+        const uint32_t *s = src.row(y);
+        uint32_t *d = &frame->at(0, y);
+        for (int x = 0; x < src.len(); ++x)
+        {
+            // alpha in r, g and b; fully opaque
+            d[x] = (s[x] >> 24) * 0x010101 | ALPHA_MASK;
+        }
     }
     return frame;
 }
@@ -1242,30 +1529,58 @@ const char *CFrame::getChunkType()
 
 void CFrame::fill(unsigned int rgba)
 {
-    for (int i = 0; i < m_nLen * m_nHei; ++i)
-    {
-        m_rgb[i] = rgba;
-    }
+    pixelFill(m_rgb, m_nLen * m_nHei, rgba);
+    invalidateMap();
 }
 
-void CFrame::drawAt(CFrame &frame, int bx, int by, bool tr)
+void CFrame::drawAt(const CFrameView &frame, int bx, int by, bool tr)
 {
-    for (int y = 0; y < frame.m_nHei; ++y)
+    // the part of frame that lands inside this one
+    const CFrameView src = frame.clip(-bx, -by, m_nLen, m_nHei);
+    const int dx = std::max(bx, 0);
+    const int dy = std::max(by, 0);
+    for (int y = 0; y < src.hei(); ++y)
     {
-        if (by + y >= m_nHei)
+        const uint32_t *s = src.row(y);
+        uint32_t *d = &at(dx, dy + y);
+        if (!tr)
         {
-            break;
+            memmove(d, s, src.len() * sizeof(uint32_t));
+            continue;
         }
-        for (int x = 0; x < frame.m_nLen; ++x)
+        for (int x = 0; x < src.len(); ++x)
         {
-            if (bx + x >= m_nLen)
-            {
-                break;
-            }
-            if (!tr || frame.at(x, y))
-                at(bx + x, by + y) = frame.at(x, y);
+            if (s[x])
+                d[x] = s[x];
         }
     }
+    invalidateMap();
+}
+
+/////////////////////////////////////////////////////////////////////
+// CFrameView
+
+CFrameView CFrameView::clip(int mx, int my, int cx, int cy) const
+{
+    if (cx == -1)
+    {
+        cx = m_nLen - mx;
+    }
+
+    if (cy == -1)
+    {
+        cy = m_nHei - my;
+    }
+
+    const int x0 = std::max(mx, 0);
+    const int y0 = std::max(my, 0);
+    const int x1 = std::min(mx + cx, m_nLen);
+    const int y1 = std::min(my + cy, m_nHei);
+    if (x1 <= x0 || y1 <= y0)
+    {
+        return CFrameView();
+    }
+    return CFrameView(&at(x0, y0), m_stride, x1 - x0, y1 - y0);
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -1334,7 +1649,12 @@ bool CSS3Map::isNULL() const
 
 CSS3Map &CSS3Map::operator=(const CSS3Map &src)
 {
-    resize(src.length(), src.height());
+    if (this == &src)
+    {
+        return *this;
+    }
+    // resize() takes pixel dimensions
+    resize(src.length() * GRID, src.height() * GRID);
     if (!src.isNULL())
     {
         memcpy(m_map, src.getMap(), m_len * m_hei);
@@ -1343,6 +1663,13 @@ CSS3Map &CSS3Map::operator=(const CSS3Map &src)
     return *this;
 }
 
+void CSS3Map::swap(CSS3Map &other)
+{
+    std::swap(m_map, other.m_map);
+    std::swap(m_len, other.m_len);
+    std::swap(m_hei, other.m_hei);
+}
+
 char *CSS3Map::getMap() const
 {
     return m_map;
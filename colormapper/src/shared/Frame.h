@@ -20,9 +20,17 @@
 // CFrame
 
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "PngFilter.h"
 
+class CFrame;
 class CFrameSet;
+class CPixelPool;
 class CDotArray;
 class CSS3Map;
 class CUndo;
@@ -46,6 +54,11 @@ public:
         return m_map[x + y * m_len];
     }
 
+    inline char at(const int x, const int y) const
+    {
+        return m_map[x + y * m_len];
+    }
+
     int length() const;
     int height() const;
 
@@ -54,6 +67,7 @@ public:
     bool isNULL() const;
 
     CSS3Map &operator=(const CSS3Map &src);
+    void swap(CSS3Map &other);
     char *getMap() const;
 
     enum
@@ -67,14 +81,64 @@ protected:
     int m_hei;
 };
 
+// pngOptions_t : toPng() encoder settings
+
+struct pngOptions_t
+{
+    int level = -1;                     // zlib level (-1: Z_DEFAULT_COMPRESSION)
+    int threads = 1;                    // deflate workers (0: one per core)
+    int filter = PNG_FILTER_ADAPTIVE;   // PNG_FILTER_* type or selection mode
+    bool palette = false;               // indexed output for <= 256 colours
+};
+
+// fillOptions_t : floodFill() settings
+
+struct fillOptions_t
+{
+    int tolerance = 0;      // max difference per channel from the target
+    bool diagonal = false;  // 8-connected instead of 4-connected
+    bool alphaOnly = false; // match and paint the alpha channel only
+};
+
+// CFrameView : non-owning window on rgba rows (a frame or part of one)
+
+class CFrameView
+{
+public:
+    CFrameView() {}
+    CFrameView(uint32_t *rgb, int stride, int len, int hei)
+        : m_rgb(rgb), m_stride(stride), m_nLen(len), m_nHei(hei) {}
+    CFrameView(const CFrame &frame);
+
+    inline uint32_t &at(int x, int y) const { return m_rgb[x + y * m_stride]; }
+    inline uint32_t *row(int y) const { return m_rgb + y * m_stride; }
+    inline uint32_t *getRGB() const { return m_rgb; }
+    inline int stride() const { return m_stride; }
+    inline int len() const { return m_nLen; }
+    inline int hei() const { return m_nHei; }
+    inline bool isNULL() const { return m_nLen <= 0 || m_nHei <= 0; }
+
+    // sub-rectangle clamped to this view (cx, cy = -1: up to the edge)
+    CFrameView clip(int mx, int my, int cx = -1, int cy = -1) const;
+
+protected:
+    uint32_t *m_rgb = nullptr;
+    int m_stride = 0;
+    int m_nLen = 0;
+    int m_nHei = 0;
+};
+
 // CFrame
 
 class CFrame
 {
     // Construction
 public:
-    CFrame(CFrame *src = nullptr);
-    CFrame(int p_nLen, int p_nHei);
+    CFrame(const CFrame *src = nullptr);
+    CFrame(const CFrame &src);
+    CFrame(CFrame &&src) noexcept;
+    CFrame(int p_nLen, int p_nHei, const std::shared_ptr<CPixelPool> &pool = nullptr);
+    CFrame(const CFrameView &src, const std::shared_ptr<CPixelPool> &pool = nullptr);
 
     // Attributes
 public:
@@ -99,17 +163,24 @@ public:
     }
 
     inline uint32_t *getRGB() const { return m_rgb; }
-    void setRGB(uint32_t *rgb) { m_rgb = rgb; }
-    inline char map(int x, int y) { return m_map.at(x, y); }
+    // rgb must come from pool()->alloc(len() * hei()); the frame takes it over
+    void setRGB(uint32_t *rgb);
+    const std::shared_ptr<CPixelPool> &pool() const { return m_pool; }
+    inline char map(int x, int y) const { return getMap().at(x, y); }
     bool hasTransparency() const;
     bool isEmpty() const;
 
     // Operations
 public:
     CFrame &operator=(const CFrame &src);
+    CFrame &operator=(CFrame &&src) noexcept;
+    CFrameView view(int mx = 0, int my = 0, int cx = -1, int cy = -1) const;
     void forget();
     void detach() { m_rgb = nullptr; }
     void updateMap();
+    // the map is rebuilt on the next getMap() / map(); call this after
+    // writing pixels through at(), point() or getRGB()
+    void invalidateMap() { m_mapDirty = true; }
     void resize(int len, int hei);
     void setTransparency(uint32_t rgba);
     void setTopPixelAsTranparency();
@@ -117,11 +188,18 @@ public:
     void flipV();
     void flipH();
     void rotate();
+    // clockwise, in multiples of 90 degrees
+    void rotate(int degrees);
     CFrameSet *split(int pxSize, bool whole = true);
+    std::vector<CFrameView> tiles(int pxSize) const;
     void spreadH();
     void spreadV();
     void clear();
     void shrink();
+    // resample to len x hei with a RESAMPLE_* filter (Resampler.h)
+    void scale(int len, int hei, int filter);
+    // builds the map if it is out of date; may be called from several
+    // threads at once (writing pixels still needs exclusive access)
     const CSS3Map &getMap() const;
     void shiftUP(const bool wrap = true);
     void shiftDOWN(const bool wrap = true);
@@ -134,10 +212,12 @@ public:
     void argb2arbg();
     void floodFill(int x, int y, uint32_t bOldColor, uint32_t bNewColor);
     void floodFillAlpha(int x, int y, uint8_t oldAlpha, uint8_t newAlpha);
+    void floodFill(int x, int y, uint32_t target, uint32_t color, const fillOptions_t &options);
     void fade(int factor);
     CFrame *toAlphaGray(int mx = 0, int my = 0, int cx = -1, int cy = -1);
+    static CFrame *toAlphaGray(const CFrameView &src, const std::shared_ptr<CPixelPool> &pool = nullptr);
     void fill(unsigned int rgba);
-    void drawAt(CFrame &frame, int bx, int by, bool tr);
+    void drawAt(const CFrameView &frame, int bx, int by, bool tr);
 
     // Implementation
 public:
@@ -146,7 +226,7 @@ public:
     void write(IFile &file);
 
     void toBmp(uint8_t *&bmp, int &size);
-    void toPng(uint8_t *&png, int &size, uint8_t *obl5data = nullptr, int obl5size = 0);
+    void toPng(uint8_t *&png, int &size, uint8_t *obl5data = nullptr, int obl5size = 0, const pngOptions_t &options = pngOptions_t());
     static uint32_t toNet(const uint32_t a);
     static const uint32_t *dosPal();
     bool draw(CDotArray *dots, int size, int mode = MODE_NORMAL);
@@ -160,6 +240,8 @@ public:
     void redo();
     bool canUndo();
     bool canRedo();
+    // memory the undo history may hold, in bytes (0: unlimited)
+    void setUndoBudget(size_t budget);
 
     inline int len() const { return m_nLen; }
     inline int hei() const { return m_nHei; }
@@ -173,8 +255,7 @@ public:
         bmpHeaderSize = 40,
         pngHeaderSize = 8,
         png_IHDR_Size = 21,
-        pngChunkLimit = 32767,
-        MAX_UNDO = 20
+        pngChunkLimit = 32767
     };
 
     typedef struct
@@ -223,11 +304,18 @@ protected:
 
     int m_bCustomMap;
     uint32_t *m_rgb;
-    CSS3Map m_map;
-    CFrame **m_undoFrames;
-    int m_undoPtr;
-    int m_undoSize;
+    std::shared_ptr<CPixelPool> m_pool;
+    mutable CSS3Map m_map;
+    mutable std::atomic<bool> m_mapDirty;
+    mutable std::mutex m_mapMutex;
+    std::unique_ptr<CUndo> m_undo;
     void init();
+    void buildMap() const;
+    void releaseRGB();
+    void swapImage(CFrame &other);
 };
 
+inline CFrameView::CFrameView(const CFrame &frame)
+    : m_rgb(frame.getRGB()), m_stride(frame.len()), m_nLen(frame.len()), m_nHei(frame.hei()) {}
+
 /////////////////////////////////////////////////////////////////////////////
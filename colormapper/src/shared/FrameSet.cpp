@@ -27,6 +27,8 @@
 #include "IFile.h"
 #include "PngMagic.h"
 #include "helper.h"
+#include "PixelPool.h"
+#include <vector>
 
 /////////////////////////////////////////////////////////////////////////////
 // CFrameSet
@@ -37,8 +39,10 @@ CFrameSet::CFrameSet()
 {
     m_max = GROWBY;
     m_arrFrames = new CFrame *[m_max];
+    m_pool = std::make_shared<CPixelPool>(CPixelPool::CACHE_FROM_LIVE);
     m_name = "";
     m_size = 0;
+    m_packedCount = 0;
     assignNewUUID();
 }
 
@@ -46,7 +50,9 @@ CFrameSet::CFrameSet(CFrameSet *s)
 {
     m_max = GROWBY;
     m_arrFrames = new CFrame *[m_max];
+    m_pool = std::make_shared<CPixelPool>(CPixelPool::CACHE_FROM_LIVE);
     m_size = 0;
+    m_packedCount = 0;
 
     for (int i = 0; i < s->getSize(); i++)
     {
@@ -63,6 +69,11 @@ CFrameSet::CFrameSet(CFrameSet *s)
     }
 }
 
+const std::shared_ptr<CPixelPool> &CFrameSet::pool() const
+{
+    return m_pool;
+}
+
 void CFrameSet::assignNewUUID()
 {
     m_tags["UUID"] = getUUID();
@@ -78,8 +89,12 @@ CFrameSet::~CFrameSet()
 /////////////////////////////////////////////////////////////////////////////
 // CFrameSet serialization
 
-void CFrameSet::write0x501(IFile &file)
+bool CFrameSet::write0x501(IFile &file)
 {
+    if (!materialize())
+    {
+        return false;
+    }
     long totalSize = 0;
     for (int n = 0; n < getSize(); ++n)
     {
@@ -106,7 +121,9 @@ void CFrameSet::write0x501(IFile &file)
     if (err != Z_OK)
     {
         // CLuaVM::debugv("CFrameSet::write0x501 error: %d", err);
-        return;
+        m_lastError = "CFrameSet::write0x501 compression failed";
+        delete[] buffer;
+        return false;
     }
 
     // OBL5 IMAGESET HEADER
@@ -125,6 +142,15 @@ void CFrameSet::write0x501(IFile &file)
     // OBL5 DATA
     file.write(dest, destSize);
 
+    writeTags(file);
+
+    delete[] buffer;
+    delete[] dest;
+    return true;
+}
+
+void CFrameSet::writeTags(IFile &file)
+{
     // TAG COUNT
     int count = 0;
     for (auto const & kv : m_tags)
@@ -147,9 +173,99 @@ void CFrameSet::write0x501(IFile &file)
             file << val;
         }
     }
+}
 
-    delete[] buffer;
-    delete[] dest;
+bool CFrameSet::write0x502(IFile &file)
+{
+    // len and hei are stored as uint16 (packed frames were read as such)
+    for (int n = 0; n < m_size; ++n)
+    {
+        if (!isPacked(n) && (m_arrFrames[n]->len() > UINT16_MAX || m_arrFrames[n]->hei() > UINT16_MAX))
+        {
+            m_lastError = "CFrameSet::write0x502 frame " + std::to_string(n) + " too large for OBL5";
+            return false;
+        }
+    }
+
+    // compress every frame into its own zlib stream; frames that were
+    // never unpacked are copied over as is
+    std::vector<uint8_t *> dest(m_size, nullptr);
+    std::vector<uLong> destSize(m_size, 0);
+    std::vector<int> errs(m_size, Z_OK);
+    parallelFor(m_size, [&](int n) {
+        if (isPacked(n))
+        {
+            destSize[n] = m_packed[n].size;
+            return;
+        }
+        CFrame *frame = m_arrFrames[n];
+        errs[n] = compressData((uint8_t *)frame->getRGB(),
+                               4 * frame->len() * frame->hei(),
+                               &dest[n], destSize[n]);
+    });
+
+    // sizes and offsets are stored as uint32
+    uint64_t totalSize = 0;
+    bool failed = false;
+    for (int n = 0; n < m_size; ++n)
+    {
+        failed |= errs[n] != Z_OK;
+        totalSize += destSize[n];
+    }
+
+    if (failed)
+    {
+        m_lastError = "CFrameSet::write0x502 compression failed";
+    }
+    else if (totalSize > UINT32_MAX)
+    {
+        m_lastError = "CFrameSet::write0x502 data too large for OBL5";
+        failed = true;
+    }
+    else
+    {
+        // OBL5 IMAGESET HEADER
+        uint32_t srcSize = totalSize;
+        file.write(&srcSize, sizeof(uint32_t));
+
+        // IMAGE HEADER [0..n]
+        uint32_t offset = 0;
+        for (int n = 0; n < m_size; ++n)
+        {
+            int len = isPacked(n) ? m_packed[n].len : m_arrFrames[n]->len();
+            int hei = isPacked(n) ? m_packed[n].hei : m_arrFrames[n]->hei();
+            uint32_t size = destSize[n];
+            file.write(&len, sizeof(uint16_t));
+            file.write(&hei, sizeof(uint16_t));
+            file.write(&offset, sizeof(uint32_t));
+            file.write(&size, sizeof(uint32_t));
+            offset += size;
+        }
+
+        // OBL5 DATA
+        for (int n = 0; n < m_size; ++n)
+        {
+            if (isPacked(n))
+            {
+                file.write(m_packed[n].data->data() + m_packed[n].offset, destSize[n]);
+            }
+            else
+            {
+                file.write(dest[n], destSize[n]);
+            }
+        }
+
+        writeTags(file);
+    }
+
+    for (int n = 0; n < m_size; ++n)
+    {
+        if (dest[n])
+        {
+            delete[] dest[n];
+        }
+    }
+    return !failed;
 }
 
 bool CFrameSet::write(IFile &file)
@@ -164,6 +280,10 @@ bool CFrameSet::write(IFile &file)
 
     case 0x500:
         // original version
+        if (!materialize())
+        {
+            return false;
+        }
         for (int n = 0; n < getSize(); ++n)
         {
             m_arrFrames[n]->write(file);
@@ -172,8 +292,11 @@ bool CFrameSet::write(IFile &file)
 
     case 0x501:
         // packed
-        write0x501(file);
-        break;
+        return write0x501(file);
+
+    case 0x502:
+        // packed, one zlib stream per frame
+        return write0x502(file);
 
     default:
         char tmp[256];
@@ -210,14 +333,26 @@ bool CFrameSet::read0x501(IFile &file, int size)
     char *ptr = buffer;
 
     // read OBL5Data (compressed)
-
-    uint8_t *srcBuffer = new uint8_t[srcSize];
-    file.read(srcBuffer, srcSize);
+    // inflated in place when the file is mapped
+    const uint8_t *mapped = file.data();
+    uint8_t *srcBuffer = nullptr;
+    const uint8_t *src;
+    if (mapped && srcSize <= file.getSize() - file.tell())
+    {
+        src = mapped + file.tell();
+        file.seek(file.tell() + srcSize);
+    }
+    else
+    {
+        srcBuffer = new uint8_t[srcSize];
+        file.read(srcBuffer, srcSize);
+        src = srcBuffer;
+    }
 
     int err = uncompress(
         (uint8_t *)buffer,
         (uLong *)&totalSize,
-        (uint8_t *)srcBuffer,
+        src,
         (uLong)srcSize);
 
     if (err)
@@ -230,13 +365,24 @@ bool CFrameSet::read0x501(IFile &file, int size)
     // add frames to frameSet
     for (int n = 0; n < size; ++n)
     {
-        CFrame *frame = new CFrame(len[n], hei[n]);
+        CFrame *frame = new CFrame(len[n], hei[n], m_pool);
         memcpy(frame->getRGB(), ptr, 4 * frame->len() * frame->hei());
-        frame->updateMap();
+        frame->invalidateMap();
         add(frame);
         ptr += 4 * frame->len() * frame->hei();
     }
 
+    readTags(file);
+
+    delete[] buffer;
+    delete[] len;
+    delete[] hei;
+
+    return !err;
+}
+
+void CFrameSet::readTags(IFile &file)
+{
     // TAG COUNT
     int count = 0;
     file.read(&count, sizeof(uint32_t));
@@ -249,12 +395,106 @@ bool CFrameSet::read0x501(IFile &file, int size)
         file >> val;
         m_tags[key] = val;
     }
+}
 
-    delete[] buffer;
-    delete[] len;
-    delete[] hei;
+bool CFrameSet::read0x502(IFile &file, int size)
+{
+    // OBL5 IMAGESET HEADER
+    uint32_t srcSize = 0;
+    file.read(&srcSize, sizeof(uint32_t));
 
-    return !err;
+    // IMAGE HEADER [0..n]
+    // only the index is parsed here: frames are inflated on first
+    // access (see operator[]) or all at once by materialize()
+    auto src = std::make_shared<std::vector<uint8_t>>(srcSize);
+    m_packed.resize(size);
+    for (int n = 0; n < size; ++n)
+    {
+        packedFrame_t &packed = m_packed[n];
+        packed.data = src;
+        file.read(&packed.len, sizeof(uint16_t));
+        file.read(&packed.hei, sizeof(uint16_t));
+        file.read(&packed.offset, sizeof(uint32_t));
+        file.read(&packed.size, sizeof(uint32_t));
+        if (packed.offset > srcSize || packed.size > srcSize - packed.offset)
+        {
+            m_packed.clear();
+            m_lastError = "corrupted OBL5 frame index";
+            return false;
+        }
+        add(nullptr);
+    }
+    m_packedCount = size;
+
+    // read OBL5Data (compressed)
+    file.read(src->data(), srcSize);
+
+    readTags(file);
+    return true;
+}
+
+bool CFrameSet::isPacked(int n) const
+{
+    return n < (int)m_packed.size() && m_packed[n].data;
+}
+
+int CFrameSet::unpack(int n) const
+{
+    // a frame that fails to decode stays packed
+    packedFrame_t &packed = m_packed[n];
+    CFrame *frame = new CFrame(packed.len, packed.hei, m_pool);
+    uLong expected = 4 * frame->len() * frame->hei();
+    uLong destSize = expected;
+    int err = uncompress((uint8_t *)frame->getRGB(), &destSize,
+                         packed.data->data() + packed.offset, packed.size);
+    if (err == Z_OK && destSize != expected)
+    {
+        err = Z_DATA_ERROR;
+    }
+    if (err != Z_OK)
+    {
+        delete frame;
+        return err;
+    }
+    frame->invalidateMap();
+    m_arrFrames[n] = frame;
+    packed.data.reset();
+    --m_packedCount;
+    return err;
+}
+
+bool CFrameSet::materialize()
+{
+    // packed frames are independent streams: inflate them concurrently
+    std::vector<int> errs(m_packed.size(), Z_OK);
+    parallelFor(m_packed.size(), [&](int n) {
+        if (isPacked(n))
+        {
+            errs[n] = unpack(n);
+        }
+    });
+
+    int failed = 0;
+    for (size_t n = 0; n < errs.size(); ++n)
+    {
+        if (errs[n] != Z_OK && !failed++)
+        {
+            char tmp[128];
+            sprintf(tmp, "failed to decode OBL5 frame %d: %d", (int)n, errs[n]);
+            m_lastError = tmp;
+        }
+    }
+
+    if (failed)
+    {
+        char tmp[64];
+        sprintf(tmp, " (%d frames)", failed);
+        m_lastError += tmp;
+        return false;
+    }
+
+    m_packed.clear();
+    return true;
 }
 
 bool CFrameSet::read(IFile &file)
@@ -285,12 +525,12 @@ bool CFrameSet::read(IFile &file)
 
         for (uint32_t n = 0; n < size; ++n)
         {
-            CFrame *temp = new CFrame;
+            CFrame *temp = new CFrame(0, 0, m_pool);
             if (!temp->read(file, version))
             {
                 return false;
             }
-            temp->updateMap();
+            temp->invalidateMap();
             add(temp);
         }
         result = true;
@@ -300,6 +540,10 @@ bool CFrameSet::read(IFile &file)
         result = read0x501(file, size);
         break;
 
+    case 0x502:
+        result = read0x502(file, size);
+        break;
+
     default:
         char tmp[128];
         sprintf(tmp, "unknown OBL5 version: %x", version);
@@ -319,6 +563,21 @@ CFrame *CFrameSet::operator[](int n) const
 {
     if (!(n & 0x8000) && n < m_size && n >= 0)
     {
+        if (m_packedCount)
+        {
+            std::lock_guard<std::mutex> lock(m_packedMutex);
+            if (isPacked(n))
+            {
+                int err = unpack(n);
+                if (err != Z_OK)
+                {
+                    char tmp[128];
+                    sprintf(tmp, "failed to decode OBL5 frame %d: %d", n, err);
+                    m_lastError = tmp;
+                    return &tframe;
+                }
+            }
+        }
         return m_arrFrames[n];
     }
     else
@@ -361,6 +620,8 @@ void CFrameSet::forget()
         }
     }
     m_size = 0;
+    m_packed.clear();
+    m_packedCount = 0;
     m_tags.clear();
 }
 
@@ -404,8 +665,12 @@ int CFrameSet::add(CFrame *pFrame)
     return true;
 }
 
-void CFrameSet::insertAt(int n, CFrame *pFrame)
+bool CFrameSet::insertAt(int n, CFrame *pFrame)
 {
+    if (!materialize())
+    {
+        return false;
+    }
     if (n == m_size)
     {
         add(pFrame);
@@ -429,11 +694,15 @@ void CFrameSet::insertAt(int n, CFrame *pFrame)
         m_arrFrames[n] = pFrame;
     }
 
-    return;
+    return true;
 }
 
 CFrame *CFrameSet::removeAt(int n)
 {
+    if (!materialize())
+    {
+        return nullptr;
+    }
     CFrame *rm = m_arrFrames[n];
     if (n != m_size - 1)
     {
@@ -465,6 +734,8 @@ void CFrameSet::removeAll()
     }
 
     m_size = 0;
+    m_packed.clear();
+    m_packedCount = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -663,13 +934,13 @@ bool CFrameSet::extract(IFile &file, char *out_format)
         size = oblHead.iNbrImages;
         for (int i = 0; i < (int)oblHead.iNbrImages; ++i)
         {
-            CFrame *frame = new CFrame(oblHead.iLen * 16, oblHead.iHei * 16);
+            CFrame *frame = new CFrame(oblHead.iLen * 16, oblHead.iHei * 16, m_pool);
             char *bitmap = new char[oblHead.iLen * 16 * oblHead.iHei * 16];
             USER_OBL3 obl;
             file.read(&obl, sizeof(USER_OBL3));
             file.read(bitmap, oblHead.iLen * 16 * oblHead.iHei * 16);
             bitmap2rgb(bitmap, frame->getRGB(), frame->len(), frame->hei(), -16);
-            frame->updateMap();
+            frame->invalidateMap();
             add(frame);
             delete[] bitmap;
         }
@@ -689,7 +960,7 @@ bool CFrameSet::extract(IFile &file, char *out_format)
             int hei;
             file >> len;
             file >> hei;
-            CFrame *frame = new CFrame(len, hei);
+            CFrame *frame = new CFrame(len, hei, m_pool);
             int mapped;
             file >> mapped;
             char *bitmap = new char[len * hei];
@@ -715,9 +986,8 @@ bool CFrameSet::extract(IFile &file, char *out_format)
                 }
                 delete[] pSrc;
             }
-            frame->setRGB(new uint32_t[frame->len() * frame->hei()]);
             bitmap2rgb(bitmap, frame->getRGB(), frame->len(), frame->hei(), -16);
-            frame->updateMap();
+            frame->invalidateMap();
             add(frame);
             delete[] bitmap;
         }
@@ -730,11 +1000,14 @@ bool CFrameSet::extract(IFile &file, char *out_format)
         file.seek(0);
         if (frameSet.read(file))
         {
+            // frames still packed are handed over without being inflated
             size = frameSet.getSize();
+            m_packed.resize(m_size);
             for (int i = 0; i < size; ++i)
             {
-                frameSet[i]->updateMap();
-                add(frameSet[i]);
+                add(frameSet.m_arrFrames[i]);
+                m_packed.push_back(frameSet.isPacked(i) ? frameSet.m_packed[i] : packedFrame_t{});
+                m_packedCount += frameSet.isPacked(i);
                 // TODO: add map if this is ever implemented
             }
             frameSet.removeAll();
@@ -757,13 +1030,13 @@ bool CFrameSet::extract(IFile &file, char *out_format)
         size = mcxHead.NbrImages;
         for (int i = 0; i < mcxHead.NbrImages; ++i)
         {
-            CFrame *frame = new CFrame(32,32);
+            CFrame *frame = new CFrame(32, 32, m_pool);
             char *bitmap = new char[32 * 32];
             USER_MCX mcx;
             file.read(&mcx, sizeof(USER_MCX));
             memcpy(bitmap, &mcx.ImageData[0][0], 32 * 32);
             bitmap2rgb(bitmap, frame->getRGB(), frame->len(), frame->hei(), -16);
-            frame->updateMap();
+            frame->invalidateMap();
             add(frame);
             delete[] bitmap;
         }
@@ -805,10 +1078,10 @@ bool CFrameSet::extract(IFile &file, char *out_format)
                 cpt++;
             }
         }
-        CFrame *frame = new CFrame(imc1Head.len * 8, imc1Head.hei * 8);
+        CFrame *frame = new CFrame(imc1Head.len * 8, imc1Head.hei * 8, m_pool);
         char *bitmap = ima2bitmap((char *)xptr, imc1Head.len, imc1Head.hei);
         bitmap2rgb(bitmap, frame->getRGB(), frame->len(), frame->hei(), 0);
-        frame->updateMap();
+        frame->invalidateMap();
         add(frame);
         delete[] xptrIMC1;
         delete[] xptr;
@@ -837,12 +1110,12 @@ bool CFrameSet::extract(IFile &file, char *out_format)
             return false;
         }
         size = 1;
-        CFrame *frame = new CFrame(imaHead.len * 8, imaHead.hei * 8);
+        CFrame *frame = new CFrame(imaHead.len * 8, imaHead.hei * 8, m_pool);
         char *pIMA = new char[dataSize];
         file.read(pIMA, dataSize);
         char *bitmap = ima2bitmap(pIMA, imaHead.len, imaHead.hei);
         bitmap2rgb(bitmap, frame->getRGB(), frame->len(), frame->hei(), 0);
-        frame->updateMap();
+        frame->invalidateMap();
         add(frame);
         delete[] pIMA;
         delete[] bitmap;
@@ -881,11 +1154,25 @@ bool CFrameSet::isFriendFormat(const char *format)
 void CFrameSet::move(int s, int t)
 {
     CFrame *f = removeAt(s);
-    insertAt(t, f);
+    if (f)
+    {
+        insertAt(t, f);
+    }
+}
+
+bool CFrameSet::toPng(unsigned char *&data, int &size)
+{
+    return toPng(data, size, pngOptions_t());
 }
 
-void CFrameSet::toPng(unsigned char *&data, int &size)
+bool CFrameSet::toPng(unsigned char *&data, int &size, const pngOptions_t &options)
 {
+    if (!materialize())
+    {
+        data = nullptr;
+        size = 0;
+        return false;
+    }
     if (m_size > 1)
     {
         short *xx = new short[m_size];
@@ -932,7 +1219,7 @@ void CFrameSet::toPng(unsigned char *&data, int &size)
                yy, m_size * sizeof(short));
 
         // TODO: inject obldata into png
-        frame->toPng(data, size, buf, t_size);
+        frame->toPng(data, size, buf, t_size, options);
         delete frame;
         delete[] buf;
         delete []xx;
@@ -942,7 +1229,7 @@ void CFrameSet::toPng(unsigned char *&data, int &size)
     {
         if (m_size)
         {
-            m_arrFrames[0]->toPng(data, size);
+            m_arrFrames[0]->toPng(data, size, nullptr, 0, options);
         }
         else
         {
@@ -950,6 +1237,7 @@ void CFrameSet::toPng(unsigned char *&data, int &size)
             size = 0;
         }
     }
+    return true;
 }
 
 void CFrameSet::setLastError(const char *error)
@@ -972,7 +1260,7 @@ void CFrameSet::toSubset(CFrameSet &dest, int start, int end)
     int last = end == -1 ? getSize() - 1 : end;
     for (int i = start; i <= last; ++i)
     {
-        CFrame *p = new CFrame(m_arrFrames[i]);
+        CFrame *p = new CFrame((*this)[i]);
         dest.add(p);
     }
 }
@@ -20,11 +20,17 @@
 
 #include <string>
 #include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <stdint.h>
 #include "ISerial.h"
 
 class CFrame;
+class CPixelPool;
 class IFile;
+struct pngOptions_t;
 
 // FrameSet.h : header file
 //
@@ -49,6 +55,8 @@ public:
     int operator++();
     int operator--();
 
+    // safe to call from several threads at once: packed frames are
+    // decoded under a lock. Other members are not thread-safe.
     CFrame *operator[](int) const;
     CFrameSet &operator=(CFrameSet &s);
     int add(CFrame *pFrame);
@@ -56,7 +64,7 @@ public:
     const char *getName() const;
 
     CFrame *removeAt(int n);
-    void insertAt(int n, CFrame *pFrame);
+    bool insertAt(int n, CFrame *pFrame);
     void forget();
     void removeAll();
     bool extract(IFile &file, char *format = nullptr);
@@ -69,12 +77,15 @@ public:
 
     const char *getLastError() const;
     void setLastError(const char *error);
-    void toPng(unsigned char *&data, int &size);
+    bool toPng(unsigned char *&data, int &size);
+    bool toPng(unsigned char *&data, int &size, const pngOptions_t &options);
     std::string &tag(const char *tag);
     void setTag(const char *tag, const char *v);
     void copyTags(CFrameSet &src);
     void assignNewUUID();
     void toSubset(CFrameSet &dest, int start, int end = -1);
+    bool materialize();
+    const std::shared_ptr<CPixelPool> &pool() const;
 
     // Implementation
 public:
@@ -85,16 +96,37 @@ public:
 
     enum
     {
-        OBL_VERSION = 0x501,
+        OBL_VERSION = 0x502,
         GROWBY = 16
     };
 
 protected:
-    void write0x501(IFile &file);
+    // frame still held as its zlib stream (0x502 files are loaded lazily)
+    typedef struct
+    {
+        std::shared_ptr<std::vector<uint8_t>> data;
+        uint32_t offset;
+        uint32_t size;
+        uint16_t len;
+        uint16_t hei;
+    } packedFrame_t;
+
+    bool isPacked(int n) const;
+    int unpack(int n) const;
+
+    bool write0x501(IFile &file);
     bool read0x501(IFile &file, int size);
+    bool write0x502(IFile &file);
+    bool read0x502(IFile &file, int size);
+    void writeTags(IFile &file);
+    void readTags(IFile &file);
 
-    std::string m_lastError;
+    mutable std::string m_lastError;
     CFrame **m_arrFrames;
+    std::shared_ptr<CPixelPool> m_pool;
+    mutable std::vector<packedFrame_t> m_packed;
+    mutable std::atomic<int> m_packedCount;
+    mutable std::mutex m_packedMutex;
     int m_max;
     int m_size;
     std::string m_name;
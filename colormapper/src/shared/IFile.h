@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <stdint.h>
 
 class IFile
 {
@@ -44,4 +45,8 @@ public:
     virtual long getSize() = 0;
     virtual void seek(long i) = 0;
     virtual long tell() = 0;
+
+    // whole file contents when they are memory resident (e.g. mapped),
+    // nullptr otherwise; valid until close()
+    virtual const uint8_t *data() { return nullptr; }
 };
@@ -0,0 +1,390 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PixelOps.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is not enabled for the whole build; its kernels are compiled
+// with a target attribute and picked at run time
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_USE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t ALPHA = 0xff000000;
+    const uint32_t COLOR = 0x00ffffff;
+
+    inline uint32_t swapRB(uint32_t c)
+    {
+        uint32_t t = c & 0xff00ff00;
+        if (t & ALPHA)
+        {
+            t |= ((c & 0xff) << 16) | ((c >> 16) & 0xff);
+        }
+        return t;
+    }
+
+    inline uint32_t swapGB(uint32_t c)
+    {
+        uint32_t t = c & 0xff0000ff;
+        if (t & ALPHA)
+        {
+            t |= ((c & 0xff00) << 8) | ((c >> 8) & 0xff00);
+        }
+        return t;
+    }
+
+#if defined(PIXEL_USE_AVX2)
+    bool hasAvx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    // each kernel returns the number of pixels done, a multiple of 8
+
+    __attribute__((target("avx2"))) size_t fillAVX2(uint32_t *rgb, size_t count, uint32_t rgba)
+    {
+        size_t i = 0;
+        const __m256i v = _mm256_set1_epi32(rgba);
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_si256((__m256i *)(rgb + i), v);
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t inverseAVX2(uint32_t *rgb, size_t count)
+    {
+        size_t i = 0;
+        const __m256i mask = _mm256_set1_epi32(COLOR);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i *p = (__m256i *)(rgb + i);
+            _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t mapAlphaAVX2(uint32_t *rgb, size_t count, const uint8_t lut[256])
+    {
+        size_t i = 0;
+        // gather from the table widened to the alpha position
+        alignas(32) uint32_t wide[256];
+        for (int a = 0; a < 256; ++a)
+        {
+            wide[a] = (uint32_t)lut[a] << 24;
+        }
+        const __m256i color = _mm256_set1_epi32(COLOR);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i *p = (__m256i *)(rgb + i);
+            __m256i c = _mm256_loadu_si256(p);
+            __m256i a = _mm256_i32gather_epi32((const int *)wide, _mm256_srli_epi32(c, 24), 4);
+            _mm256_storeu_si256(p, _mm256_or_si256(_mm256_and_si256(c, color), a));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t swapRBAVX2(uint32_t *rgb, size_t count)
+    {
+        size_t i = 0;
+        const __m256i keep = _mm256_set1_epi32(0xff00ff00);
+        const __m256i low = _mm256_set1_epi32(0xff);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i *p = (__m256i *)(rgb + i);
+            __m256i c = _mm256_loadu_si256(p);
+            __m256i rb = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(c, low), 16),
+                                         _mm256_and_si256(_mm256_srli_epi32(c, 16), low));
+            __m256i clear = _mm256_cmpeq_epi32(_mm256_srli_epi32(c, 24), zero);
+            _mm256_storeu_si256(p, _mm256_or_si256(_mm256_and_si256(c, keep), _mm256_andnot_si256(clear, rb)));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t swapGBAVX2(uint32_t *rgb, size_t count)
+    {
+        size_t i = 0;
+        const __m256i keep = _mm256_set1_epi32(0xff0000ff);
+        const __m256i green = _mm256_set1_epi32(0xff00);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i *p = (__m256i *)(rgb + i);
+            __m256i c = _mm256_loadu_si256(p);
+            __m256i gb = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(c, green), 8),
+                                         _mm256_and_si256(_mm256_srli_epi32(c, 8), green));
+            __m256i clear = _mm256_cmpeq_epi32(_mm256_srli_epi32(c, 24), zero);
+            _mm256_storeu_si256(p, _mm256_or_si256(_mm256_and_si256(c, keep), _mm256_andnot_si256(clear, gb)));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t clearColorAVX2(uint32_t *rgb, size_t count, uint32_t color)
+    {
+        size_t i = 0;
+        const __m256i mask = _mm256_set1_epi32(COLOR);
+        const __m256i key = _mm256_set1_epi32(color);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i *p = (__m256i *)(rgb + i);
+            __m256i c = _mm256_loadu_si256(p);
+            __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(c, mask), key);
+            _mm256_storeu_si256(p, _mm256_andnot_si256(hit, c));
+        }
+        return i;
+    }
+
+    // stops early at the first block holding a match
+    template <bool TRANSPARENT>
+    __attribute__((target("avx2"))) size_t anyAlphaAVX2(const uint32_t *rgb, size_t count)
+    {
+        size_t i = 0;
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i a = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i *)(rgb + i)), 24);
+            int clear = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, zero)));
+            if (TRANSPARENT ? clear != 0 : clear != 0xff)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+#endif
+}
+
+void pixelFill(uint32_t *rgb, size_t count, uint32_t rgba)
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = fillAVX2(rgb, count, rgba);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i v = _mm_set1_epi32(rgba);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128((__m128i *)(rgb + i), v);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rgb[i] = rgba;
+    }
+}
+
+void pixelInverse(uint32_t *rgb, size_t count)
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = inverseAVX2(rgb, count);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i mask = _mm_set1_epi32(COLOR);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(rgb + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rgb[i] ^= COLOR;
+    }
+}
+
+void pixelMapAlpha(uint32_t *rgb, size_t count, const uint8_t lut[256])
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = mapAlphaAVX2(rgb, count, lut);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    // no gather in SSE2: four pixels sharing one alpha (runs of opaque or
+    // clear pixels) take a single lookup, mixed blocks go pixel by pixel
+    const __m128i color = _mm_set1_epi32(COLOR);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(rgb + i);
+        __m128i c = _mm_loadu_si128(p);
+        const uint32_t alpha = rgb[i] >> 24;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(c, 24), _mm_set1_epi32(alpha))) == 0xffff)
+        {
+            _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(c, color), _mm_set1_epi32((uint32_t)lut[alpha] << 24)));
+            continue;
+        }
+        for (size_t j = i; j < i + 4; ++j)
+        {
+            rgb[j] = (rgb[j] & COLOR) | ((uint32_t)lut[rgb[j] >> 24] << 24);
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rgb[i] = (rgb[i] & COLOR) | ((uint32_t)lut[rgb[i] >> 24] << 24);
+    }
+}
+
+void pixelSwapRB(uint32_t *rgb, size_t count)
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = swapRBAVX2(rgb, count);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i keep = _mm_set1_epi32(0xff00ff00);
+    const __m128i low = _mm_set1_epi32(0xff);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(rgb + i);
+        __m128i c = _mm_loadu_si128(p);
+        __m128i rb = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(c, low), 16),
+                                  _mm_and_si128(_mm_srli_epi32(c, 16), low));
+        __m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(c, 24), zero);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(c, keep), _mm_andnot_si128(clear, rb)));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rgb[i] = swapRB(rgb[i]);
+    }
+}
+
+void pixelSwapGB(uint32_t *rgb, size_t count)
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = swapGBAVX2(rgb, count);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i keep = _mm_set1_epi32(0xff0000ff);
+    const __m128i green = _mm_set1_epi32(0xff00);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(rgb + i);
+        __m128i c = _mm_loadu_si128(p);
+        __m128i gb = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(c, green), 8),
+                                  _mm_and_si128(_mm_srli_epi32(c, 8), green));
+        __m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(c, 24), zero);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(c, keep), _mm_andnot_si128(clear, gb)));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        rgb[i] = swapGB(rgb[i]);
+    }
+}
+
+void pixelClearColor(uint32_t *rgb, size_t count, uint32_t color)
+{
+    color &= COLOR;
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    if (hasAvx2())
+    {
+        i = clearColorAVX2(rgb, count, color);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i mask = _mm_set1_epi32(COLOR);
+    const __m128i key = _mm_set1_epi32(color);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(rgb + i);
+        __m128i c = _mm_loadu_si128(p);
+        __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(c, mask), key);
+        _mm_storeu_si128(p, _mm_andnot_si128(hit, c));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        if ((rgb[i] & COLOR) == color)
+        {
+            rgb[i] = 0;
+        }
+    }
+}
+
+// true if any pixel's alpha is zero (TRANSPARENT) or non-zero (!TRANSPARENT)
+template <bool TRANSPARENT>
+static bool anyAlpha(const uint32_t *rgb, size_t count)
+{
+    size_t i = 0;
+#if defined(PIXEL_USE_AVX2)
+    // a block with a match is left to the loops below
+    if (hasAvx2())
+    {
+        i = anyAlphaAVX2<TRANSPARENT>(rgb, count);
+    }
+#endif
+#if defined(PIXEL_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i a = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(rgb + i)), 24);
+        int clear = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, zero)));
+        if (TRANSPARENT ? clear != 0 : clear != 0xf)
+        {
+            return true;
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        if (((rgb[i] & ALPHA) == 0) == TRANSPARENT)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool pixelAnyTransparent(const uint32_t *rgb, size_t count)
+{
+    return anyAlpha<true>(rgb, count);
+}
+
+bool pixelAnyOpaque(const uint32_t *rgb, size_t count)
+{
+    return anyAlpha<false>(rgb, count);
+}
@@ -0,0 +1,52 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bulk pixel kernels on rgba buffers (R in the low byte, A in the high
+// byte). SSE2 paths are picked at compile time and AVX2 ones at run time
+// when the CPU has it, with a scalar loop for the remainder and for other
+// targets.
+
+// set every pixel to rgba
+void pixelFill(uint32_t *rgb, size_t count, uint32_t rgba);
+
+// invert the colour channels, keeping alpha
+void pixelInverse(uint32_t *rgb, size_t count);
+
+// replace each alpha value a with lut[a]
+void pixelMapAlpha(uint32_t *rgb, size_t count, const uint8_t lut[256]);
+
+// swap red and blue; colours of fully transparent pixels are cleared
+// except for green (CFrame::abgr2argb)
+void pixelSwapRB(uint32_t *rgb, size_t count);
+
+// swap green and blue; colours of fully transparent pixels are cleared
+// except for red (CFrame::argb2arbg)
+void pixelSwapGB(uint32_t *rgb, size_t count);
+
+// zero every pixel whose colour (ignoring alpha) equals color
+void pixelClearColor(uint32_t *rgb, size_t count, uint32_t color);
+
+// true if any pixel has a zero alpha
+bool pixelAnyTransparent(const uint32_t *rgb, size_t count);
+
+// true if any pixel has a non-zero alpha
+bool pixelAnyOpaque(const uint32_t *rgb, size_t count);
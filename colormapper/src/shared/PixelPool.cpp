@@ -0,0 +1,246 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PixelPool.h"
+#include <algorithm>
+#include <bit>
+#include <new>
+
+CPixelPool::CPixelPool(size_t cacheLimit)
+{
+    m_slabUsed = SLAB_SIZE;
+    m_emptySlabs = 0;
+    m_cached = 0;
+    m_cachedLarge = 0;
+    m_live = 0;
+    m_cacheLimit = cacheLimit;
+}
+
+CPixelPool::~CPixelPool()
+{
+    // classes up to SLAB_CLASS_LIMIT are released with their slab
+    int last;
+    classSize(SLAB_CLASS_LIMIT, last);
+    for (int i = last + 1; i < (int)CLASS_COUNT; ++i)
+    {
+        for (void *block : m_free[i])
+        {
+            freeBlock(block);
+        }
+    }
+    for (void *slab : m_slabs)
+    {
+        freeBlock(slab, SLAB_SIZE);
+    }
+}
+
+const std::shared_ptr<CPixelPool> &CPixelPool::global()
+{
+    static const std::shared_ptr<CPixelPool> pool = std::make_shared<CPixelPool>();
+    return pool;
+}
+
+size_t CPixelPool::classSize(size_t bytes, int &index)
+{
+    // 256, 512, then four steps per power of two (at most 25% slack)
+    if (bytes <= 256)
+    {
+        index = 0;
+        return 256;
+    }
+    if (bytes <= 512)
+    {
+        index = 1;
+        return 512;
+    }
+    const int k = std::bit_width(bytes - 1) - 1;
+    const size_t step = (size_t)1 << (k - 2);
+    const int sub = (int)((bytes - 1 - ((size_t)1 << k)) / step);
+    index = 2 + (k - 9) * 4 + sub;
+    return ((size_t)1 << k) + (sub + 1) * step;
+}
+
+size_t CPixelPool::indexSize(int index)
+{
+    // inverse of classSize()
+    if (index < 2)
+    {
+        return (size_t)256 << index;
+    }
+    const int k = 9 + (index - 2) / 4;
+    const int sub = (index - 2) % 4;
+    return ((size_t)1 << k) + (sub + 1) * ((size_t)1 << (k - 2));
+}
+
+void *CPixelPool::allocBlock(size_t bytes, size_t alignment)
+{
+    return ::operator new(bytes, std::align_val_t(alignment));
+}
+
+void CPixelPool::freeBlock(void *block, size_t alignment)
+{
+    ::operator delete(block, std::align_val_t(alignment));
+}
+
+int &CPixelPool::slabUse(void *block)
+{
+    // slabs are aligned on their size; the first ALIGNMENT bytes hold
+    // the number of blocks in use
+    return *(int *)((uintptr_t)block & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+size_t CPixelPool::cacheLimit() const
+{
+    if (m_cacheLimit != CACHE_FROM_LIVE)
+    {
+        return m_cacheLimit;
+    }
+    return std::max(m_live / LIVE_SHARE, (size_t)SLAB_SIZE);
+}
+
+uint32_t *CPixelPool::alloc(int pixels)
+{
+    if (pixels <= 0)
+    {
+        return nullptr;
+    }
+    int index;
+    const size_t bytes = classSize((size_t)pixels * sizeof(uint32_t), index);
+    if (index >= (int)CLASS_COUNT)
+    {
+        return (uint32_t *)allocBlock(bytes);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live += bytes;
+    std::vector<void *> &list = m_free[index];
+    if (!list.empty())
+    {
+        void *block = list.back();
+        list.pop_back();
+        m_cached -= bytes;
+        if (bytes > SLAB_CLASS_LIMIT)
+        {
+            m_cachedLarge -= bytes;
+        }
+        else if (!slabUse(block)++)
+        {
+            --m_emptySlabs;
+        }
+        return (uint32_t *)block;
+    }
+    if (bytes > SLAB_CLASS_LIMIT)
+    {
+        return (uint32_t *)allocBlock(bytes);
+    }
+
+    // carve small blocks out of the current slab
+    if (m_slabUsed + bytes > SLAB_SIZE)
+    {
+        m_slabs.push_back(allocBlock(SLAB_SIZE, SLAB_SIZE));
+        slabUse(m_slabs.back()) = 0;
+        m_slabUsed = ALIGNMENT;
+    }
+    void *block = (uint8_t *)m_slabs.back() + m_slabUsed;
+    m_slabUsed += bytes;
+    ++slabUse(block);
+    return (uint32_t *)block;
+}
+
+void CPixelPool::release(uint32_t *rgb, int pixels)
+{
+    if (!rgb)
+    {
+        return;
+    }
+    int index;
+    const size_t bytes = classSize((size_t)pixels * sizeof(uint32_t), index);
+    if (index >= (int)CLASS_COUNT)
+    {
+        freeBlock(rgb);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live -= bytes;
+    if (bytes > SLAB_CLASS_LIMIT)
+    {
+        m_cachedLarge += bytes;
+    }
+    else if (!--slabUse(rgb))
+    {
+        ++m_emptySlabs;
+    }
+    m_free[index].push_back(rgb);
+    m_cached += bytes;
+    if (m_cached > cacheLimit())
+    {
+        trim();
+    }
+}
+
+void CPixelPool::trim()
+{
+    // called with m_mutex held
+    const size_t limit = cacheLimit();
+
+    // large blocks go first, biggest class first
+    int last;
+    classSize(SLAB_CLASS_LIMIT, last);
+    for (int i = (int)CLASS_COUNT - 1; i > last && m_cachedLarge && m_cached > limit; --i)
+    {
+        std::vector<void *> &list = m_free[i];
+        const size_t bytes = indexSize(i);
+        while (!list.empty() && m_cached > limit)
+        {
+            freeBlock(list.back());
+            list.pop_back();
+            m_cached -= bytes;
+            m_cachedLarge -= bytes;
+        }
+    }
+
+    // then every slab with no block in use, other than the one being
+    // carved; this walks the small free lists, so wait until an eighth
+    // of the slabs are empty
+    if (m_cached <= limit || m_slabs.empty())
+    {
+        return;
+    }
+    void *carving = m_slabs.back();
+    const size_t freeable = m_emptySlabs - (slabUse(carving) == 0);
+    if (!freeable || freeable < m_slabs.size() / 8)
+    {
+        return;
+    }
+    for (int i = 0; i <= last; ++i)
+    {
+        const size_t bytes = indexSize(i);
+        m_cached -= bytes * std::erase_if(m_free[i], [carving](void *block) {
+            return !slabUse(block) && (uintptr_t)block - (uintptr_t)carving >= SLAB_SIZE;
+        });
+    }
+    std::erase_if(m_slabs, [carving](void *slab) {
+        if (slab == carving || slabUse(slab))
+        {
+            return false;
+        }
+        freeBlock(slab, SLAB_SIZE);
+        return true;
+    });
+    m_emptySlabs -= freeable;
+}
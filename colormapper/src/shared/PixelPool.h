@@ -0,0 +1,78 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Size-class allocator for CFrame pixel buffers. Every block is 64-byte
+// aligned. Small blocks are carved out of slabs; freed blocks go back to
+// a per-class free list for reuse. Once the free lists hold more than the
+// cache limit, large blocks are returned to the system first, then slabs
+// none of whose blocks are in use. Frames hold a shared_ptr to their pool
+// so it outlives them. Thread-safe.
+
+class CPixelPool
+{
+public:
+    CPixelPool(size_t cacheLimit = DEFAULT_CACHE_LIMIT);
+    ~CPixelPool();
+
+    // uninitialized storage for the given number of pixels (nullptr for 0)
+    uint32_t *alloc(int pixels);
+    // return a block; pixels must match the alloc() call
+    void release(uint32_t *rgb, int pixels);
+    // pool used by frames created outside of a CFrameSet
+    static const std::shared_ptr<CPixelPool> &global();
+
+    enum : size_t
+    {
+        ALIGNMENT = 64,
+        SLAB_SIZE = 256 * 1024,
+        SLAB_CLASS_LIMIT = 16 * 1024,
+        DEFAULT_CACHE_LIMIT = 64 * 1024 * 1024,
+        // cache limit that follows the pixels in use (live / LIVE_SHARE,
+        // at least one slab); used by the per-set pools
+        CACHE_FROM_LIVE = 0,
+        LIVE_SHARE = 4,
+        CLASS_COUNT = 128
+    };
+
+protected:
+    static size_t classSize(size_t bytes, int &index);
+    static size_t indexSize(int index);
+    static void *allocBlock(size_t bytes, size_t alignment = ALIGNMENT);
+    static void freeBlock(void *block, size_t alignment = ALIGNMENT);
+    static int &slabUse(void *block);
+    size_t cacheLimit() const;
+    void trim();
+
+    std::mutex m_mutex;
+    std::vector<void *> m_free[CLASS_COUNT];
+    std::vector<void *> m_slabs;
+    size_t m_slabUsed;
+    size_t m_emptySlabs;
+    size_t m_cached;
+    size_t m_cachedLarge;
+    size_t m_live;
+    size_t m_cacheLimit;
+};
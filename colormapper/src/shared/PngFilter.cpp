@@ -0,0 +1,549 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PngFilter.h"
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PNG_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is not enabled for the whole build; its kernels are compiled
+// with a target attribute and picked at run time
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PNG_USE_AVX2
+#include <immintrin.h>
+#endif
+
+static inline uint8_t paethPredictor(int a, int b, int c)
+{
+    // p = a + b - c; distances to a, b, c
+    int pa = std::abs(b - c);
+    int pb = std::abs(a - c);
+    int pc = std::abs(a + b - 2 * c);
+    // return nearest of a, b, c
+    // breaking ties in order a, b, c.
+    if ((pa <= pb) && (pa <= pc))
+    {
+        return a;
+    }
+    else if (pb <= pc)
+    {
+        return b;
+    }
+    else
+        return c;
+}
+
+bool pngUnfilterRowScalar(uint8_t filter, uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+    switch (filter)
+    {
+    case PNG_FILTER_NONE:
+        break;
+
+    case PNG_FILTER_SUB:
+        for (int i = bpp; i < rowBytes; ++i)
+        {
+            row[i] += row[i - bpp];
+        }
+        break;
+
+    case PNG_FILTER_UP:
+        for (int i = 0; i < rowBytes; ++i)
+        {
+            row[i] += prior[i];
+        }
+        break;
+
+    case PNG_FILTER_AVERAGE:
+        for (int i = 0; i < bpp && i < rowBytes; ++i)
+        {
+            row[i] += prior[i] >> 1;
+        }
+        for (int i = bpp; i < rowBytes; ++i)
+        {
+            row[i] += (row[i - bpp] + prior[i]) >> 1;
+        }
+        break;
+
+    case PNG_FILTER_PAETH:
+        for (int i = 0; i < bpp && i < rowBytes; ++i)
+        {
+            row[i] += prior[i];
+        }
+        for (int i = bpp; i < rowBytes; ++i)
+        {
+            row[i] += paethPredictor(row[i - bpp], prior[i], prior[i - bpp]);
+        }
+        break;
+
+    default:
+        return false;
+    }
+    return true;
+}
+
+// forward filters over out[begin..end-1]; the first bpp bytes have no left
+// neighbours
+static int filterRange(uint8_t filter, uint8_t *out, const uint8_t *row, const uint8_t *prior, int begin, int end, int bpp)
+{
+    int sum = 0;
+    for (int i = begin; i < end; ++i)
+    {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = prior[i];
+        int c = i >= bpp ? prior[i - bpp] : 0;
+        uint8_t d;
+        switch (filter)
+        {
+        case PNG_FILTER_SUB:
+            d = row[i] - a;
+            break;
+        case PNG_FILTER_UP:
+            d = row[i] - b;
+            break;
+        case PNG_FILTER_AVERAGE:
+            d = row[i] - ((a + b) >> 1);
+            break;
+        case PNG_FILTER_PAETH:
+            d = row[i] - paethPredictor(a, b, c);
+            break;
+        default:
+            d = row[i];
+        }
+        out[i] = d;
+        sum += d < 128 ? d : 256 - d;
+    }
+    return sum;
+}
+
+int pngFilterRowScalar(uint8_t filter, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+    return filterRange(filter, out, row, prior, 0, rowBytes, bpp);
+}
+
+#ifdef PNG_USE_SSE2
+
+// one pixel of BPP bytes is loaded as a whole 4 or 8 byte word, so
+// callers keep i + PIXEL_WORD<BPP> within the row; the extra bytes land in
+// lanes that are never stored. Assembling the pixel bytewise in memory
+// instead stalls every load on store forwarding (3x slower than scalar).
+template <int BPP>
+constexpr int PIXEL_WORD = BPP <= 4 ? 4 : 8;
+
+template <int BPP>
+static inline __m128i loadPixel(const uint8_t *p)
+{
+    if constexpr (BPP <= 4)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return _mm_cvtsi32_si128(v);
+    }
+    else
+    {
+        return _mm_loadl_epi64((const __m128i *)p);
+    }
+}
+
+// stores exactly BPP bytes (never touching the next pixel)
+template <int BPP>
+static inline void storePixel(uint8_t *p, __m128i x)
+{
+    if constexpr (BPP <= 4)
+    {
+        uint32_t v = _mm_cvtsi128_si32(x);
+        memcpy(p, &v, BPP);
+    }
+    else
+    {
+        uint64_t v;
+        _mm_storel_epi64((__m128i *)&v, x);
+        memcpy(p, &v, BPP);
+    }
+}
+
+static inline __m128i abs16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Sub for power-of-two pixel sizes: log-step prefix sum over 16 bytes,
+// then add the last reconstructed pixel of the previous block.
+static int subPrefixSSE2(uint8_t *row, int rowBytes, int bpp)
+{
+    __m128i carry = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= rowBytes; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+        switch (bpp)
+        {
+        case 1:
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+            [[fallthrough]];
+        case 2:
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+            [[fallthrough]];
+        case 4:
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            [[fallthrough]];
+        default:
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+        }
+        x = _mm_add_epi8(x, carry);
+        _mm_storeu_si128((__m128i *)(row + i), x);
+
+        // broadcast the last pixel
+        switch (bpp)
+        {
+        case 1:
+            x = _mm_unpackhi_epi8(x, x);
+            [[fallthrough]];
+        case 2:
+            x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+            [[fallthrough]];
+        case 4:
+            carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+            break;
+        default:
+            carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+    }
+    return i;
+}
+
+// bytes past the last whole pixel (rows are normally whole pixels)
+static void unfilterTail(uint8_t filter, uint8_t *row, const uint8_t *prior, int begin, int rowBytes, int bpp)
+{
+    for (int i = begin; i < rowBytes; ++i)
+    {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        switch (filter)
+        {
+        case PNG_FILTER_SUB:
+            row[i] += a;
+            break;
+        case PNG_FILTER_AVERAGE:
+            row[i] += (a + prior[i]) >> 1;
+            break;
+        case PNG_FILTER_PAETH:
+            row[i] += paethPredictor(a, prior[i], i >= bpp ? prior[i - bpp] : 0);
+            break;
+        }
+    }
+}
+
+template <int BPP>
+static void subSSE2(uint8_t *row, int rowBytes)
+{
+    __m128i a = _mm_setzero_si128();
+    int i = 0;
+    for (; i + PIXEL_WORD<BPP> <= rowBytes; i += BPP)
+    {
+        a = _mm_add_epi8(loadPixel<BPP>(row + i), a);
+        storePixel<BPP>(row + i, a);
+    }
+    unfilterTail(PNG_FILTER_SUB, row, nullptr, i, rowBytes, BPP);
+}
+
+#ifdef PNG_USE_AVX2
+static bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// returns the number of bytes done
+__attribute__((target("avx2"))) static int upAVX2(uint8_t *row, const uint8_t *prior, int rowBytes)
+{
+    int i = 0;
+    for (; i + 32 <= rowBytes; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(row + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(prior + i));
+        _mm256_storeu_si256((__m256i *)(row + i), _mm256_add_epi8(x, b));
+    }
+    return i;
+}
+#endif
+
+static void upSIMD(uint8_t *row, const uint8_t *prior, int rowBytes)
+{
+    int i = 0;
+#ifdef PNG_USE_AVX2
+    if (hasAvx2())
+    {
+        i = upAVX2(row, prior, rowBytes);
+    }
+#endif
+    for (; i + 16 <= rowBytes; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(prior + i));
+        _mm_storeu_si128((__m128i *)(row + i), _mm_add_epi8(x, b));
+    }
+    for (; i < rowBytes; ++i)
+    {
+        row[i] += prior[i];
+    }
+}
+
+template <int BPP>
+static void averageSSE2(uint8_t *row, const uint8_t *prior, int rowBytes)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    int i = 0;
+    for (; i + PIXEL_WORD<BPP> <= rowBytes; i += BPP)
+    {
+        __m128i b = loadPixel<BPP>(prior + i);
+        // _mm_avg_epu8 rounds up, floor((a + b) / 2) is wanted
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(loadPixel<BPP>(row + i), avg);
+        storePixel<BPP>(row + i, a);
+    }
+    unfilterTail(PNG_FILTER_AVERAGE, row, prior, i, rowBytes, BPP);
+}
+
+template <int BPP>
+static void paethSSE2(uint8_t *row, const uint8_t *prior, int rowBytes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi16(0xff);
+    // a = left, c = upper left; kept as 16-bit lanes
+    __m128i a = zero;
+    __m128i c = zero;
+    int i = 0;
+    for (; i + PIXEL_WORD<BPP> <= rowBytes; i += BPP)
+    {
+        __m128i b = _mm_unpacklo_epi8(loadPixel<BPP>(prior + i), zero);
+        __m128i x = _mm_unpacklo_epi8(loadPixel<BPP>(row + i), zero);
+
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = abs16(pa);
+        pb = abs16(pb);
+        pc = abs16(pc);
+
+        __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        __m128i nearest = select(_mm_cmpeq_epi16(smallest, pa), a,
+                                 select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+        x = _mm_and_si128(_mm_add_epi16(x, nearest), lowByte);
+        storePixel<BPP>(row + i, _mm_packus_epi16(x, x));
+        a = x;
+        c = b;
+    }
+    unfilterTail(PNG_FILTER_PAETH, row, prior, i, rowBytes, BPP);
+}
+
+// forward filters are not recursive: every 16 bytes are computed at once
+template <int FILTER>
+static int filterSSE2(uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    int head = bpp < rowBytes ? bpp : rowBytes;
+    int sum = filterRange(FILTER, out, row, prior, 0, head, bpp);
+    __m128i acc = zero;
+    int i = head;
+    for (; i + 16 <= rowBytes; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i d = x;
+        if constexpr (FILTER == PNG_FILTER_SUB)
+        {
+            d = _mm_sub_epi8(x, _mm_loadu_si128((const __m128i *)(row + i - bpp)));
+        }
+        else if constexpr (FILTER == PNG_FILTER_UP)
+        {
+            d = _mm_sub_epi8(x, _mm_loadu_si128((const __m128i *)(prior + i)));
+        }
+        else if constexpr (FILTER == PNG_FILTER_AVERAGE)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(row + i - bpp));
+            __m128i b = _mm_loadu_si128((const __m128i *)(prior + i));
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            d = _mm_sub_epi8(x, avg);
+        }
+        else if constexpr (FILTER == PNG_FILTER_PAETH)
+        {
+            __m128i a8 = _mm_loadu_si128((const __m128i *)(row + i - bpp));
+            __m128i b8 = _mm_loadu_si128((const __m128i *)(prior + i));
+            __m128i c8 = _mm_loadu_si128((const __m128i *)(prior + i - bpp));
+            __m128i half[2];
+            for (int h = 0; h < 2; ++h)
+            {
+                __m128i a = h ? _mm_unpackhi_epi8(a8, zero) : _mm_unpacklo_epi8(a8, zero);
+                __m128i b = h ? _mm_unpackhi_epi8(b8, zero) : _mm_unpacklo_epi8(b8, zero);
+                __m128i c = h ? _mm_unpackhi_epi8(c8, zero) : _mm_unpacklo_epi8(c8, zero);
+                __m128i pa = _mm_sub_epi16(b, c);
+                __m128i pb = _mm_sub_epi16(a, c);
+                __m128i pc = _mm_add_epi16(pa, pb);
+                pa = abs16(pa);
+                pb = abs16(pb);
+                pc = abs16(pc);
+                __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                half[h] = select(_mm_cmpeq_epi16(smallest, pa), a,
+                                 select(_mm_cmpeq_epi16(smallest, pb), b, c));
+            }
+            d = _mm_sub_epi8(x, _mm_packus_epi16(half[0], half[1]));
+        }
+        _mm_storeu_si128((__m128i *)(out + i), d);
+        // |(int8_t)d| == min(d, -d) taken as unsigned bytes
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_min_epu8(d, _mm_sub_epi8(zero, d)), zero));
+    }
+    sum += _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    return sum + filterRange(FILTER, out, row, prior, i, rowBytes, bpp);
+}
+
+#endif
+
+int pngFilterRow(uint8_t filter, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+#ifdef PNG_USE_SSE2
+    switch (filter)
+    {
+    case PNG_FILTER_SUB:
+        return filterSSE2<PNG_FILTER_SUB>(out, row, prior, rowBytes, bpp);
+    case PNG_FILTER_UP:
+        return filterSSE2<PNG_FILTER_UP>(out, row, prior, rowBytes, bpp);
+    case PNG_FILTER_AVERAGE:
+        return filterSSE2<PNG_FILTER_AVERAGE>(out, row, prior, rowBytes, bpp);
+    case PNG_FILTER_PAETH:
+        return filterSSE2<PNG_FILTER_PAETH>(out, row, prior, rowBytes, bpp);
+    default:
+        return filterSSE2<PNG_FILTER_NONE>(out, row, prior, rowBytes, bpp);
+    }
+#else
+    return pngFilterRowScalar(filter, out, row, prior, rowBytes, bpp);
+#endif
+}
+
+uint8_t pngSelectFilter(int mode, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+    if (mode < PNG_FILTER_COUNT)
+    {
+        pngFilterRow(mode, out, row, prior, rowBytes, bpp);
+        return mode;
+    }
+
+    // candidates are tried into a scratch row, the best one is kept in out
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize(rowBytes);
+    int count = mode == PNG_FILTER_FAST ? PNG_FILTER_AVERAGE : PNG_FILTER_COUNT;
+    uint8_t best = PNG_FILTER_NONE;
+    int bestSum = pngFilterRow(PNG_FILTER_NONE, out, row, prior, rowBytes, bpp);
+    for (int filter = PNG_FILTER_SUB; filter < count; ++filter)
+    {
+        int sum = pngFilterRow(filter, scratch.data(), row, prior, rowBytes, bpp);
+        if (sum < bestSum)
+        {
+            bestSum = sum;
+            best = filter;
+            memcpy(out, scratch.data(), rowBytes);
+        }
+    }
+    return best;
+}
+
+bool pngUnfilterRow(uint8_t filter, uint8_t *row, const uint8_t *prior, int rowBytes, int bpp)
+{
+#ifdef PNG_USE_SSE2
+    switch (filter)
+    {
+    case PNG_FILTER_NONE:
+        return true;
+
+    case PNG_FILTER_SUB:
+        switch (bpp)
+        {
+        case 1:
+        case 2:
+        case 4:
+        case 8:
+        {
+            int i = subPrefixSSE2(row, rowBytes, bpp);
+            for (i = i ? i : bpp; i < rowBytes; ++i)
+            {
+                row[i] += row[i - bpp];
+            }
+            return true;
+        }
+        case 3:
+            subSSE2<3>(row, rowBytes);
+            return true;
+        case 6:
+            subSSE2<6>(row, rowBytes);
+            return true;
+        }
+        break;
+
+    case PNG_FILTER_UP:
+        upSIMD(row, prior, rowBytes);
+        return true;
+
+    case PNG_FILTER_AVERAGE:
+        switch (bpp)
+        {
+        case 3:
+            averageSSE2<3>(row, prior, rowBytes);
+            return true;
+        case 4:
+            averageSSE2<4>(row, prior, rowBytes);
+            return true;
+        case 6:
+            averageSSE2<6>(row, prior, rowBytes);
+            return true;
+        case 8:
+            averageSSE2<8>(row, prior, rowBytes);
+            return true;
+        }
+        break;
+
+    case PNG_FILTER_PAETH:
+        switch (bpp)
+        {
+        case 3:
+            paethSSE2<3>(row, prior, rowBytes);
+            return true;
+        case 4:
+            paethSSE2<4>(row, prior, rowBytes);
+            return true;
+        case 6:
+            paethSSE2<6>(row, prior, rowBytes);
+            return true;
+        case 8:
+            paethSSE2<8>(row, prior, rowBytes);
+            return true;
+        }
+        break;
+    }
+#endif
+    return pngUnfilterRowScalar(filter, row, prior, rowBytes, bpp);
+}
@@ -0,0 +1,60 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stdint.h>
+
+// PNG scanline filter kernels
+//
+// row   : filtered bytes of the current scanline (without the filter byte)
+// prior : reconstructed bytes of the previous scanline; an all-zero row
+//         must be supplied for the first scanline of an image (or pass)
+// bpp   : bytes per complete pixel, rounded up to 1 for bit depths < 8
+
+enum
+{
+    PNG_FILTER_NONE,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH,
+    PNG_FILTER_COUNT
+};
+
+// encoder filter selection (on top of the fixed filter types above)
+enum
+{
+    PNG_FILTER_ADAPTIVE = PNG_FILTER_COUNT, // best of all five per row
+    PNG_FILTER_FAST                         // best of none, sub and up
+};
+
+// reconstruct a scanline in place; returns false on unknown filter types
+bool pngUnfilterRow(uint8_t filter, uint8_t *row, const uint8_t *prior, int rowBytes, int bpp);
+
+// portable reference implementation (used for the remainders of the SIMD paths)
+bool pngUnfilterRowScalar(uint8_t filter, uint8_t *row, const uint8_t *prior, int rowBytes, int bpp);
+
+// filter a scanline for encoding into out (rowBytes bytes); returns the
+// sum of the filtered bytes' magnitudes taken as signed values
+int pngFilterRow(uint8_t filter, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp);
+int pngFilterRowScalar(uint8_t filter, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp);
+
+// filter a scanline with a fixed type or the candidate giving the minimum
+// sum of absolute differences (PNG_FILTER_ADAPTIVE / PNG_FILTER_FAST);
+// returns the filter type written
+uint8_t pngSelectFilter(int mode, uint8_t *out, const uint8_t *row, const uint8_t *prior, int rowBytes, int bpp);
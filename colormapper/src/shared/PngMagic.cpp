@@ -22,9 +22,11 @@
 #include <string>
 #include <cstring>
 #include <cstdio>
-#include <cmath>
+#include <vector>
+#include <algorithm>
 #include "CRC.h"
 #include "IFile.h"
+#include "PngFilter.h"
 
 /* These describe the color_type field in png_info. */
 /* color type masks */
@@ -42,40 +44,74 @@
 #define PNG_COLOR_TYPE_RGBA  PNG_COLOR_TYPE_RGB_ALPHA
 #define PNG_COLOR_TYPE_GA  PNG_COLOR_TYPE_GRAY_ALPHA
 
+const CPngMagic::pngFormat_t CPngMagic::m_formats[] = {
+    {PNG_COLOR_TYPE_GRAY, 1, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY, 1>},
+    {PNG_COLOR_TYPE_GRAY, 2, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY, 2>},
+    {PNG_COLOR_TYPE_GRAY, 4, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY, 4>},
+    {PNG_COLOR_TYPE_GRAY, 8, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY, 8>},
+    {PNG_COLOR_TYPE_GRAY, 16, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY, 16>},
+    {PNG_COLOR_TYPE_RGB, 8, 3, &CPngMagic::convertRow<PNG_COLOR_TYPE_RGB, 8>},
+    {PNG_COLOR_TYPE_RGB, 16, 3, &CPngMagic::convertRow<PNG_COLOR_TYPE_RGB, 16>},
+    {PNG_COLOR_TYPE_PALETTE, 1, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_PALETTE, 1>},
+    {PNG_COLOR_TYPE_PALETTE, 2, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_PALETTE, 2>},
+    {PNG_COLOR_TYPE_PALETTE, 4, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_PALETTE, 4>},
+    {PNG_COLOR_TYPE_PALETTE, 8, 1, &CPngMagic::convertRow<PNG_COLOR_TYPE_PALETTE, 8>},
+    {PNG_COLOR_TYPE_GRAY_ALPHA, 8, 2, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY_ALPHA, 8>},
+    {PNG_COLOR_TYPE_GRAY_ALPHA, 16, 2, &CPngMagic::convertRow<PNG_COLOR_TYPE_GRAY_ALPHA, 16>},
+    {PNG_COLOR_TYPE_RGB_ALPHA, 8, 4, &CPngMagic::convertRow<PNG_COLOR_TYPE_RGB_ALPHA, 8>},
+    {PNG_COLOR_TYPE_RGB_ALPHA, 16, 4, &CPngMagic::convertRow<PNG_COLOR_TYPE_RGB_ALPHA, 16>},
+};
+
+const CPngMagic::pngPass_t CPngMagic::m_passes[] = {
+    // progressive
+    {0, 0, 1, 1},
+    // Adam7
+    {0, 0, 8, 8},
+    {4, 0, 8, 8},
+    {0, 4, 4, 8},
+    {2, 0, 4, 4},
+    {0, 2, 2, 4},
+    {1, 0, 2, 2},
+    {0, 1, 1, 2},
+};
+
 CPngMagic::CPngMagic()
 {
 }
 
-uint8_t CPngMagic::PaethPredictor(uint8_t a, uint8_t b, uint8_t c)
+const CPngMagic::pngFormat_t *CPngMagic::findFormat(const png_IHDR &ihdr)
 {
-     int p = a + b - c ; //initial estimate
-     int pa = std::abs((float)p - a); //distances to a, b, c
-     int pb = std::abs((float)p - b); //
-     int pc = std::abs((float)p - c);
-              //; return nearest of a,b,c,
-              //; breaking ties in order a,b,c.
-     if ((pa <= pb) && (pa <= pc)) {
-         return a;
-     } else if (pb <= pc) {
-         return b;
-     } else return c;
+    if (ihdr.Compression || ihdr.Filter || ihdr.Interlace > 1) {
+        return nullptr;
+    }
+    for (const pngFormat_t &format : m_formats) {
+        if (format.colorType == ihdr.ColorType && format.bitDepth == ihdr.BitDepth) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+int CPngMagic::rowBytes(const pngFormat_t &format, int width)
+{
+    return (width * format.channels * format.bitDepth + 7) / 8;
 }
 
 bool CPngMagic::parsePNG(CFrameSet &set, IFile &file)
 {
-//    int size = 0;
     CCRC crc;
-    int pos = 8;
-    int fileSize = file.getSize();
-    //printf("fileSize: %d\n", fileSize);
+    long pos = 8;
+    long fileSize = file.getSize();
+    // chunk payloads are consumed in place when the file is mapped
+    const uint8_t *mapped = file.data();
 
     file.seek( 8 );
-    int chunkSize;
 
     png_IHDR ihdr;
     memset(&ihdr, 0, sizeof(png_IHDR));
 
     uint8_t plte[256][3];
+    memset(plte, 0, sizeof(plte));
     uint8_t trns[256];
     for (int i=0; i < 256; i++) {
         trns[i] = 255;
@@ -85,436 +121,363 @@ bool CPngMagic::parsePNG(CFrameSet &set, IFile &file)
     memcpy(png_chunk_OBL5, CFrame::getChunkType(),4);
 
     bool iend_found = false;
-    //bool ihdr_found = false;
-    //bool plte_found = false;
     bool trns_found = false;
-    //bool oblt_found = false;
 
-    uint8_t *cData = nullptr;
     int obl5t_count = 0;
-    short *obl5t_xx = nullptr;
-    short *obl5t_yy = nullptr;
-    int cDataSize = 0;
-
-    while (pos < fileSize) {
-        file.read(&chunkSize, 4);
+    std::vector<short> obl5t_xx;
+    std::vector<short> obl5t_yy;
+
+    // IDAT payloads are fed to a single inflate stream as they
+    // are read; only the ancillary chunks are buffered (reused)
+    std::vector<uint8_t> chunkData;
+    const uint8_t *chunk = nullptr;
+    uint8_t inBuf[IDAT_BUFFER_SIZE];
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    bool inflating = false;
+    bool zdone = false;
+    std::string error;
+
+    // scanlines are inflated one at a time into two rolling buffers
+    // (filter byte + row) and written straight into the frame; interlaced
+    // images go through the seven Adam7 passes, each a small image
+    CFrame *frame = nullptr;
+    const pngFormat_t *format = nullptr;
+    pngContext_t ctx;
+    std::vector<uint8_t> rowBuf[2];
+    std::vector<uint32_t> passRow;
+    int current = 0;
+    int pitch = 0;
+    int fill = 0;
+    int width = 0;
+    int height = 0;
+    int offsetY = 0;
+    int pass = 0;
+    int lastPass = 0;
+    int passWidth = 0;
+    int passHeight = 0;
+    int passY = 0;
+
+    // move on to the next pass holding any pixels
+    auto nextPass = [&]() {
+        for (++pass; pass <= lastPass; ++pass) {
+            const pngPass_t &p = m_passes[pass];
+            passWidth = width > p.x0 ? (width - p.x0 + p.dx - 1) / p.dx : 0;
+            passHeight = height > p.y0 ? (height - p.y0 + p.dy - 1) / p.dy : 0;
+            if (passWidth && passHeight) {
+                break;
+            }
+        }
+        if (pass <= lastPass) {
+            pitch = rowBytes(*format, passWidth) + 1;
+            rowBuf[0].assign(pitch, 0);
+            rowBuf[1].assign(pitch, 0);
+            current = 0;
+            passY = 0;
+        }
+    };
+
+    while (pos + 12 <= fileSize && error.empty()) {
+        uint8_t header[8];
+        file.read(header, 8);
+        pos += 8;
+        uint32_t chunkSize;
+        memcpy(&chunkSize, header, 4);
         chunkSize = CFrame::toNet(chunkSize);
-        pos += 4;
+        const uint8_t *chunkType = header + 4;
+        if (chunkSize > (uint32_t)(fileSize - pos - 4)) {
+            error = "truncated png chunk";
+            break;
+        }
 
-        char chunkType[5];
-        chunkType[4] = 0;
-        file.read(chunkType, 4); pos += 4;
+        unsigned long crc32c = crc.update_crc(0xffffffffL, chunkType, 4);
+        if (memcmp (chunkType, "IDAT", 4) == 0) {
+            if (!inflating) {
+                format = findFormat(ihdr);
+                if ( !ihdr.Width || !ihdr.Height || !format ) {
+                    error = "unsupported png";
+                    break;
+                }
+                if (inflateInit(&zs) != Z_OK) {
+                    error = "inflateInit failed";
+                    break;
+                }
+                inflating = true;
+                // PLTE and tRNS precede IDAT: the converter is set up once
+                initContext(ctx, ihdr, plte, trns_found, trns);
+
+                height = CFrame::toNet(ihdr.Height);
+                width = CFrame::toNet(ihdr.Width);
+                if (height & 7) {
+                    offsetY = 8 - (height & 7);
+                }
+                frame = new CFrame(width + ((8 - (width & 7)) & 7), height + offsetY, set.pool());
+                pass = ihdr.Interlace ? 0 : -1;
+                lastPass = ihdr.Interlace ? 7 : 0;
+                nextPass();
+            }
 
-        uint8_t * p = new uint8_t [ chunkSize + 4] ;
-        file.read(p + 4, chunkSize); pos += chunkSize;
-        //memset(chunkData + chunkSize, 0, 4);
-        memcpy(p, chunkType, 4);
-        uint8_t *chunkData = p + 4;
+            uint32_t left = chunkSize;
+            while (left) {
+                uint32_t n;
+                const uint8_t *in;
+                if (mapped) {
+                    n = left;
+                    in = mapped + pos;
+                } else {
+                    n = std::min(left, (uint32_t) sizeof(inBuf));
+                    file.read(inBuf, n);
+                    in = inBuf;
+                }
+                crc32c = crc.update_crc(crc32c, in, n);
+                left -= n;
+                zs.next_in = (Bytef*) in;
+                zs.avail_in = n;
+                while (zs.avail_in && !zdone) {
+                    // once every row is decoded, the remainder of the
+                    // stream is still inflated to validate the checksum
+                    uint8_t *row = rowBuf[current].data();
+                    zs.next_out = row + fill;
+                    zs.avail_out = pitch - fill;
+                    int err = inflate(&zs, Z_NO_FLUSH);
+                    fill = pitch - zs.avail_out;
+                    if (fill == pitch) {
+                        fill = 0;
+                        if (pass <= lastPass) {
+                            uint8_t *prior = rowBuf[current ^ 1].data();
+                            if (!pngUnfilterRow(row[0], row + 1, prior + 1, pitch - 1, pixelBytes(*format))) {
+                                char tmp[128];
+                                snprintf(tmp, sizeof(tmp), "unsupported png filtering: %d", row[0]);
+                                error = tmp;
+                                break;
+                            }
+                            const pngPass_t &p = m_passes[pass];
+                            int y = offsetY + p.y0 + passY * p.dy;
+                            if (p.dx == 1) {
+                                format->convert(&frame->at(0, y), row + 1, passWidth, ctx);
+                            } else {
+                                passRow.resize(passWidth);
+                                format->convert(passRow.data(), row + 1, passWidth, ctx);
+                                for (int i = 0; i < passWidth; ++i) {
+                                    frame->at(p.x0 + i * p.dx, y) = passRow[i];
+                                }
+                            }
+                            current ^= 1;
+                            if (++passY == passHeight) {
+                                nextPass();
+                            }
+                        }
+                    }
+                    if (err == Z_STREAM_END) {
+                        zdone = true;
+                    } else if (err != Z_OK) {
+                        char tmp[128];
+                        snprintf(tmp, sizeof(tmp), "Zlib compression error %d: %s", err, zError(err));
+                        error = tmp;
+                        break;
+                    }
+                }
+                if (!error.empty()) {
+                    break;
+                }
+            }
+            pos += chunkSize;
+        } else {
+            if (mapped) {
+                chunk = mapped + pos;
+            } else {
+                chunkData.resize(chunkSize);
+                file.read(chunkData.data(), chunkSize);
+                chunk = chunkData.data();
+            }
+            crc32c = crc.update_crc(crc32c, chunk, chunkSize);
+            pos += chunkSize;
+        }
+        if (mapped) {
+            file.seek(pos);
+        }
+        if (!error.empty()) {
+            break;
+        }
 
-        int crc32;
-        file.read(&crc32, 4); pos += 4;
+        uint32_t crc32;
+        file.read(&crc32, 4);
+        pos += 4;
         crc32 = CFrame::toNet(crc32);
-        // TODO: check crc32 values for each chunk
-        int crc32c = crc.crc(p, chunkSize +4);
-        //qDebug("crc32: %.8x %.8x", crc32, crc32c);
-        if (crc32 != crc32c) {
-            set.setLastError("CRC32 checksum doesn't match");
-            delete [] p;
-            return false;
+        if (crc32 != (crc32c ^ 0xffffffffL)) {
+            error = "CRC32 checksum doesn't match";
+            break;
         }
 
         if (memcmp (chunkType, "IHDR", 4) == 0) {
-            memcpy( ((uint8_t*)&ihdr) + 8, chunkData, chunkSize );
+            memcpy( ((uint8_t*)&ihdr) + 8, chunk, std::min(chunkSize, (uint32_t) png_IHDR_DATA_SIZE) );
             memcpy(ihdr.ChunkType, chunkType, 4);
             ihdr.Lenght = chunkSize;
-            /*
-            qDebug("Width: %d, Height: %d", CFrame::toNet(ihdr.Width), CFrame::toNet(ihdr.Height));
-            qDebug("BitDepth: %d", ihdr.BitDepth);
-            qDebug("ColorType: %d", ihdr.ColorType);
-            qDebug("Compression: %d", ihdr.Compression);
-            qDebug("Filter: %d", ihdr.Filter);
-            qDebug("Interlace: %d\n", ihdr.Interlace);
-            //              ihdr_found = true;
-            */
         }
 
-        if (memcmp (chunkType, "PLTE", 4) == 0) {
-            memcpy(plte, chunkData, chunkSize);
-            //            plte_found = true;
-        }
-
-        if (memcmp (chunkType, "IDAT", 4) == 0) {
-            if (cData) {
-                uint8_t *tmp = new uint8_t [ cDataSize + chunkSize ];
-                memcpy( tmp, cData, cDataSize );
-                delete [] cData;
-                cData = tmp;
-                memcpy( cData + cDataSize, chunkData, chunkSize);
-            } else {
-                cData = new uint8_t [ chunkSize ];
-                memcpy( cData, chunkData, chunkSize);
-            }
-            cDataSize += chunkSize;
+        else if (memcmp (chunkType, "PLTE", 4) == 0) {
+            memcpy(plte, chunk, std::min(chunkSize, (uint32_t) sizeof(plte)));
         }
 
-        if (memcmp (chunkType, "tRNS", 4) == 0) {
-            memcpy(trns, chunkData, chunkSize);
+        else if (memcmp (chunkType, "tRNS", 4) == 0) {
+            memcpy(trns, chunk, std::min(chunkSize, (uint32_t) sizeof(trns)));
             trns_found = true;
         }
 
-        if (memcmp (chunkType, "IEND", 4) == 0) {
+        else if (memcmp (chunkType, "IEND", 4) == 0) {
             iend_found = true;
+            break;
         }
 
-        if (memcmp (chunkType, png_chunk_OBL5, 4) == 0) {
-            //oblt_found = true;
+        else if (memcmp (chunkType, png_chunk_OBL5, 4) == 0 && chunkSize >= 12) {
             CFrame::png_OBL5 obl5t;
             char *t = (char*)&obl5t;
-            memcpy(t + 8, chunkData, 12);
-            if (obl5t.Version == 0) {
+            memcpy(t + 8, chunk, 12);
+            if (obl5t.Version == 0 && chunkSize >= 12 + 2 * sizeof(short) * obl5t.Count) {
                 // only version 0x0000 is supported
                 obl5t_count = obl5t.Count;
-                obl5t_xx = new short[obl5t.Count];
-                obl5t_yy = new short[obl5t.Count];
-                memcpy(obl5t_xx, chunkData + 12,
+                obl5t_xx.resize(obl5t.Count);
+                obl5t_yy.resize(obl5t.Count);
+                memcpy(obl5t_xx.data(), chunk + 12,
                        sizeof(short) * obl5t.Count);
-                memcpy(obl5t_yy, chunkData + 12 + sizeof(short) * obl5t.Count,
+                memcpy(obl5t_yy.data(), chunk + 12 + sizeof(short) * obl5t.Count,
                        sizeof(short) * obl5t.Count);
             }
         }
-
-        delete [] p;//chunkData;
     }
 
-    bool valid = false;
-    if (cData && iend_found) {
-        //qDebug("total cData:%d\n", cDataSize);
-        if ( !ihdr.Interlace &&
-             ((ihdr.BitDepth == 8) || (ihdr.BitDepth == 4)) &&
-             (ihdr.ColorType != PNG_COLOR_TYPE_GRAY) &&
-             (ihdr.ColorType != PNG_COLOR_TYPE_GRAY_ALPHA) ) {
-            int height = CFrame::toNet(ihdr.Height);
-            int width = CFrame::toNet(ihdr.Width);
-            int offsetY = 0;
-            if (width & 7) {
-                width += (8 - (width & 7));
-            }
-            if (height & 7) {
-                offsetY = 8 - (height & 7);
-                height += offsetY;
-            }
-            CFrame *frame = new CFrame(width, height);
-            memset(frame->getRGB(), 0, sizeof(uint32_t) * frame->len() * frame->hei());
+    if (inflating) {
+        inflateEnd(&zs);
+    }
 
-            if (ihdr.BitDepth == 8) {
-                valid = _8bpp(frame, cData, cDataSize, ihdr, plte, trns_found, trns, offsetY);
-            }
+    if (error.empty() && inflating && iend_found && pass <= lastPass) {
+        error = "Zlib compression error: incomplete image data";
+    }
 
-            if (ihdr.BitDepth == 4) {
-                valid = _4bpp(frame, cData, cDataSize, ihdr, plte, trns_found, trns, offsetY);
-            }
+    if (!error.empty()) {
+        set.setLastError(error.c_str());
+        delete frame;
+        return false;
+    }
 
-           // qDebug("valid: %d", valid);
-            if (valid) {
-                if (obl5t_count) {
-                    frame->explode(obl5t_count,obl5t_xx,obl5t_yy,&set);
-                    delete[] obl5t_xx;
-                    delete[] obl5t_yy;
-                    delete frame;
-                } else {
-                    frame->updateMap();
-                    set.add(frame);
-                }
-            } else {
-                set.setLastError("unsupported png filtering");
-                delete frame;
-          //      size = 0;
-            }
+    bool valid = false;
+    if (frame && iend_found) {
+        valid = true;
+        if (obl5t_count) {
+            frame->explode(obl5t_count, obl5t_xx.data(), obl5t_yy.data(), &set);
+            delete frame;
         } else {
-            set.setLastError("unsupported png");
+            frame->invalidateMap();
+            set.add(frame);
         }
-        delete [] cData;
+    } else {
+        delete frame;
     }
     return valid;
 }
 
-bool CPngMagic::_8bpp(
-        CFrame *&frame,
-        uint8_t *cData,
-        int cDataSize,
+int CPngMagic::pixelBytes(const pngFormat_t &format)
+{
+    // sub-byte pixels are filtered bytewise
+    return std::max(1, format.channels * format.bitDepth / 8);
+}
+
+void CPngMagic::initContext(
+        pngContext_t &ctx,
         const png_IHDR &ihdr,
         const uint8_t plte[][3],
         const bool trns_found,
-        const uint8_t trns[],
-        int offsetY)
+        const uint8_t trns[])
 {
-    int pixelWidth = -1;
-
-    switch (ihdr.ColorType) {
-    case PNG_COLOR_TYPE_PALETTE:
-        pixelWidth = 1;
-        break;
-    case PNG_COLOR_TYPE_RGB:
-        pixelWidth = 3;
-        break;
-    case PNG_COLOR_TYPE_RGB_ALPHA:
-        pixelWidth = 4;
-    }
-
-    //printf("pixelWidth %d\n", pixelWidth);
-
-    int pitch = CFrame::toNet(ihdr.Width) * pixelWidth + 1;
-    //printf("pixelWidth: %d\n", pixelWidth);
-    //printf("pitch: %d\n", pitch);
-
-    uLong dataSize = pitch * CFrame::toNet(ihdr.Height);
-    uint8_t *data = new uint8_t [ dataSize ];
-    //    printf("total data:%d\n", ((int)dataSize));
-
-    int err = uncompress(
-                (uint8_t *)data,
-                (uLong *)& dataSize,
-                (uint8_t *)cData,
-                (uLong) cDataSize);
-
-    if (err) {
-//        set.setLastError("error in decomp");
-        //qDebug("error in decomp");
-        delete [] data;
-        return false;
-    }
-
-    bool valid = true;
-    uint32_t *rgb = frame->getRGB();
-
-    for (int y=0; y < (int) CFrame::toNet(ihdr.Height); y++) {
-        uint8_t *line = & data[pitch * y + 1];
-        uint8_t *prLine = nullptr;
-        if (y) {
-            prLine = & data[pitch * (y - 1) + 1];
+    memset(&ctx, 0, sizeof(ctx));
+    if (ihdr.ColorType == PNG_COLOR_TYPE_PALETTE) {
+        for (int i=0; i < 256; i++) {
+            ctx.lut[i] = plte[i][0] | (plte[i][1] << 8) | (plte[i][2] << 16) | (trns[i] << 24);
         }
-        uint8_t filtering = data[pitch * y];
-        bool handled = true;
-
-        switch ( filtering ) {
-        case 0:
-            break;
-
-        case 1:
-            for (int x=0; x < (int) CFrame::toNet(ihdr.Width); x++) {
-
-                uint32_t p = 0;
-                uint32_t c = 0;
-                if (x) {
-                    memcpy(&p, & line[ (x - 1) * pixelWidth ], pixelWidth);
-                }
-
-                memcpy(&c, & line[ x * pixelWidth ], pixelWidth);
-
-                uint8_t *pc = (uint8_t*)&c;
-                uint8_t *pp = (uint8_t*)&p;
-
-                for (int i=0; i < pixelWidth; i++) {
-                    pc [i] += pp [i];
-                }
-
-                memcpy(& line[ x * pixelWidth ], pc, pixelWidth);
-            }
-            break;
-
-        case 2:
-            for (int x=0; x < (int) CFrame::toNet(ihdr.Width); x++) {
-
-                uint32_t p = 0;
-                uint32_t c = 0;
-                if (y) {
-                    memcpy(&p, & prLine[ x * pixelWidth ], pixelWidth);
-                }
-
-                memcpy(&c, & line[ x * pixelWidth ], pixelWidth);
-
-                uint8_t *pc = (uint8_t*)&c;
-                uint8_t *pp = (uint8_t*)&p;
+    } else if (ihdr.ColorType == PNG_COLOR_TYPE_GRAY && ihdr.BitDepth <= 8) {
+        // samples are scaled up to the full 0..255 range
+        int mask = (1 << ihdr.BitDepth) - 1;
+        int key = trns_found ? (trns[0] << 8) | trns[1] : -1;
+        for (int i=0; i <= mask; i++) {
+            ctx.lut[i] = (i * 255 / mask) * 0x010101 | (i == key ? 0 : 0xff000000);
+        }
+    } else if (trns_found) {
+        ctx.keyed = true;
+        for (int i=0; i < 3; i++) {
+            ctx.key[i] = (trns[i * 2] << 8) | trns[i * 2 + 1];
+        }
+    }
+}
 
-                for (int i=0; i < pixelWidth; i++) {
-                    pc [i] += pp [i];
-                }
+template <int COLOR, int DEPTH>
+void CPngMagic::convertRow(
+        uint32_t *rgb,
+        const uint8_t *line,
+        int width,
+        const pngContext_t &ctx)
+{
+    // 16 bit samples are reduced to their high byte
+    constexpr int S = DEPTH / 8;
 
-                memcpy(& line[ x * pixelWidth ], & c, pixelWidth);
+    if constexpr (COLOR == PNG_COLOR_TYPE_PALETTE || (COLOR == PNG_COLOR_TYPE_GRAY && DEPTH <= 8)) {
+        if constexpr (DEPTH == 8) {
+            for (int x=0; x < width; x++) {
+                rgb [x] = ctx.lut [ line [ x ] ];
             }
-            break;
-
-        case 3:
-            for (int x=0; x < (int) CFrame::toNet(ihdr.Width); x++) {
-
-                uint32_t a = 0; // left
-                uint32_t b = 0; // above (Prior)
-
-                if (x) {
-                    memcpy(&a, & line[ (x - 1) * pixelWidth ], pixelWidth);
-                }
-
-                if (y) {
-                    memcpy(&b, & prLine[ x * pixelWidth ], pixelWidth);
-                }
-
-                uint8_t *pa = (uint8_t*) &a;
-                uint8_t *pb = (uint8_t*) &b;
-                uint8_t *ph = & line[ x * pixelWidth ];
-
-                for (int i=0; i < pixelWidth; i++) {
-                    ph [i] += (pa [i] + pb[i]) / 2;
+        } else {
+            // leftmost pixel in the high bits
+            constexpr int PER_BYTE = 8 / DEPTH;
+            constexpr int MASK = (1 << DEPTH) - 1;
+            int x = 0;
+            for (; x + PER_BYTE <= width; x += PER_BYTE) {
+                int b = line [ x / PER_BYTE ];
+                for (int i=0; i < PER_BYTE; i++) {
+                    rgb [x + i] = ctx.lut [ (b >> (8 - DEPTH * (i + 1))) & MASK ];
                 }
             }
-
-            break;
-
-        case 4:
-            for (int x = 0; x < (int) CFrame::toNet(ihdr.Width); x++) {
-                uint32_t a = 0; // left
-                uint32_t b = 0; // above
-                uint32_t c = 0; // above-left
-
-                if (x) {
-                    memcpy(&a, & line[ (x - 1) * pixelWidth ], pixelWidth);
-                }
-
-                if (y) {
-                    memcpy(&b, & prLine[ x * pixelWidth ], pixelWidth);
-                    if (x) {
-                        memcpy(&c, & prLine[ (x - 1) * pixelWidth ], pixelWidth);
-                    }
-                }
-
-                uint8_t *pa = (uint8_t*) &a;
-                uint8_t *pb = (uint8_t*) &b;
-                uint8_t *pc = (uint8_t*) &c;
-
-                uint8_t *ph = & line[ x * pixelWidth ];
-                for (int i=0; i< pixelWidth; i++) {
-                    ph[i] += PaethPredictor(pa[i], pb[i], pc[i]);
-                }
+            for (int i=0; x < width; x++, i++) {
+                rgb [x] = ctx.lut [ (line [ x / PER_BYTE ] >> (8 - DEPTH * (i + 1))) & MASK ];
             }
-            break;
-
-        default:
-            handled = false;
         }
-
-        if (handled) {
-            for (int x=0; x < (int) CFrame::toNet(ihdr.Width); x++) {
-                uint32_t rgba = 0xff000000;
-                switch (pixelWidth) {
-                case 1:
-                    memcpy(&rgba, plte[ line [ x ] ], 3);
-
-                    if (trns_found) {
-                        rgba &= (trns[ line [ x ] ] * 0x1000000) + 0xffffff;
-                    }
-                    break;
-
-                case 3:
-                case 4:
-                    memcpy(&rgba, & line [ x * pixelWidth ], pixelWidth );
-                    break;
-                }
-
-                rgb [(offsetY + y) * frame->len() + x] = rgba;
-            }
-        } else {
-            valid = false;
+    } else if constexpr (COLOR == PNG_COLOR_TYPE_GRAY) {
+        for (int x=0; x < width; x++) {
+            uint32_t gray = line [ x * 2 ];
+            bool clear = ctx.keyed && ((line [ x * 2 ] << 8) | line [ x * 2 + 1 ]) == ctx.key[0];
+            rgb [x] = gray * 0x010101 | (clear ? 0 : 0xff000000);
         }
-    }
-
-    delete [] data;
-    return valid;
-}
-
-bool CPngMagic::_4bpp(
-        CFrame *&frame,
-        uint8_t *cData,
-        int cDataSize,
-        const png_IHDR &ihdr,
-        const uint8_t plte[][3],
-        const bool trns_found,
-        const uint8_t trns[],
-        int offsetY)
-{
-    int height = CFrame::toNet(ihdr.Height);
-    int width = CFrame::toNet(ihdr.Width);
-
-    if (ihdr.ColorType != PNG_COLOR_TYPE_PALETTE){
-       // qDebug("colorType is not PNG_COLOR_TYPE_PALETTE");
-        return false;
-    }
-
-    int pitch = 1 + CFrame::toNet(ihdr.Width) / 2;
-    if (CFrame::toNet(ihdr.Width) & 1) {
-        ++pitch;
-    }
-    //printf("pixelWidth: %d\n", pixelWidth);
-    //printf("pitch: %d\n", pitch);
-
-    uint64_t dataSize = pitch * CFrame::toNet(ihdr.Height);
-    uint8_t *data = new uint8_t [ dataSize ];
-    //    printf("total data:%d\n", ((int)dataSize));
-
-    int err = uncompress(
-                (uint8_t *)data,
-                (uLong *)& dataSize,
-                (uint8_t *)cData,
-                (uLong) cDataSize);
-
-    if (err) {
-//        set.setLastError("error in decomp");
-    //    qDebug("error in decomp");
-        delete [] data;
-        return false;
-    }
-
-    bool valid = true;
-    uint32_t *rgb = frame->getRGB();
-
-    for (int y=0; y < height; y++) {
-        uint8_t *line = & data[pitch * y + 1];
-        //uint8_t *prLine = nullptr;
-        //if (y) {
-          //  prLine = & data[pitch * (y - 1) + 1];
-        //}
-        uint8_t filtering = data[pitch * y];
-        bool handled = true;
-
-        switch ( filtering ) {
-        case 0:
-            break;
-        default:
-            handled = false;
-        //    qDebug("unsupported filter: %d", filtering);
+    } else if constexpr (COLOR == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        for (int x=0; x < width; x++) {
+            uint32_t gray = line [ x * S * 2 ];
+            uint32_t alpha = line [ x * S * 2 + S ];
+            rgb [x] = gray * 0x010101 | (alpha << 24);
         }
-
-        if (handled) {
+    } else if constexpr (COLOR == PNG_COLOR_TYPE_RGB) {
+        if (!ctx.keyed) {
             for (int x=0; x < width; x++) {
-                uint32_t rgba = 0;
-                uint8_t index = line [ x / 2 ];
-                if (x & 1) {
-                    index &= 0x0f;
-                } else {
-                    index = index >> 4;
-                }
-
-                memcpy(&rgba, plte[ index ], 3);
-                if (trns_found) {
-                    rgba |= (trns[ index ] << 24);
-                } else {
-                    rgba |= 0xff000000;
-                }
-
-                rgb [(offsetY + y) * frame->len() + x] = rgba;
+                const uint8_t *p = & line [ x * S * 3 ];
+                rgb [x] = p[0] | (p[S] << 8) | (p[S * 2] << 16) | 0xff000000;
             }
-        } else {
-            valid = false;
+            return;
+        }
+        for (int x=0; x < width; x++) {
+            const uint8_t *p = & line [ x * S * 3 ];
+            bool clear;
+            if constexpr (S == 1) {
+                clear = p[0] == ctx.key[0] && p[1] == ctx.key[1] && p[2] == ctx.key[2];
+            } else {
+                clear = ((p[0] << 8) | p[1]) == ctx.key[0] &&
+                        ((p[2] << 8) | p[3]) == ctx.key[1] &&
+                        ((p[4] << 8) | p[5]) == ctx.key[2];
+            }
+            rgb [x] = p[0] | (p[S] << 8) | (p[S * 2] << 16) | (clear ? 0 : 0xff000000);
+        }
+    } else if constexpr (COLOR == PNG_COLOR_TYPE_RGB_ALPHA && DEPTH == 8) {
+        // same byte order as the frame
+        memcpy(rgb, line, width * 4);
+    } else {
+        for (int x=0; x < width; x++) {
+            const uint8_t *p = & line [ x * 8 ];
+            rgb [x] = p[0] | (p[2] << 8) | (p[4] << 16) | ((uint32_t) p[6] << 24);
         }
     }
-
-    return valid;
 }
@@ -43,23 +43,62 @@ protected:
         uint8_t Interlace;   //: 1 uint8_t
     } png_IHDR;
 
-    static uint8_t PaethPredictor(uint8_t a, uint8_t b, uint8_t c);
-    bool _8bpp(
-        CFrame *&frame,
-        uint8_t *cData,
-        int cDataSize,
-        const png_IHDR &ihdr,
-        const uint8_t plte[][3],
-        const bool trns_found,
-        const uint8_t trns[],
-        int offsetY);
-    bool _4bpp(
-        CFrame *&frame,
-        uint8_t *cData,
-        int cDataSize,
+    enum {
+        png_IHDR_DATA_SIZE = 13,
+        IDAT_BUFFER_SIZE = 32768
+    };
+
+    // per image decoding state shared by the row converters
+    typedef struct
+    {
+        uint32_t lut[256]; // palette or (up to 8 bit) gray -> rgba
+        bool keyed;        // tRNS color key for gray16 / rgb
+        uint16_t key[3];
+    } pngContext_t;
+
+    typedef void (*converter_t)(
+        uint32_t *rgb,
+        const uint8_t *line,
+        int width,
+        const pngContext_t &ctx);
+
+    // legal IHDR color type / bit depth combinations
+    typedef struct
+    {
+        uint8_t colorType;
+        uint8_t bitDepth;
+        uint8_t channels;
+        converter_t convert;
+    } pngFormat_t;
+
+    // Adam7 pass origin and spacing
+    typedef struct
+    {
+        uint8_t x0;
+        uint8_t y0;
+        uint8_t dx;
+        uint8_t dy;
+    } pngPass_t;
+
+    static const pngFormat_t m_formats[];
+    static const pngPass_t m_passes[];
+
+    static const pngFormat_t *findFormat(const png_IHDR &ihdr);
+    static int rowBytes(const pngFormat_t &format, int width);
+    static int pixelBytes(const pngFormat_t &format);
+
+    static void initContext(
+        pngContext_t &ctx,
         const png_IHDR &ihdr,
         const uint8_t plte[][3],
         const bool trns_found,
-        const uint8_t trns[],
-        int offsetY);
+        const uint8_t trns[]);
+
+    // row converters to rgba, one instance per color type / bit depth
+    template <int COLOR, int DEPTH>
+    static void convertRow(
+        uint32_t *rgb,
+        const uint8_t *line,
+        int width,
+        const pngContext_t &ctx);
 };
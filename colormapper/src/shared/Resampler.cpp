@@ -0,0 +1,386 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Resampler.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float PI = 3.14159265358979f;
+
+    const char *FILTER_NAMES[RESAMPLE_FILTER_COUNT] = {
+        "nearest",
+        "box",
+        "bilinear",
+        "lanczos3",
+        "scale2x",
+    };
+
+    // one pixel as four floats: three colours premultiplied by alpha, then alpha
+#ifdef RESAMPLE_USE_SSE2
+    typedef __m128 vec4;
+
+    inline vec4 vzero() { return _mm_setzero_ps(); }
+    inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+    inline void vstore(float *p, vec4 v) { _mm_storeu_ps(p, v); }
+    inline vec4 vmadd(vec4 acc, vec4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+
+    inline vec4 premultiply(uint32_t c)
+    {
+        const __m128i z = _mm_setzero_si128();
+        __m128i i = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(c), z), z);
+        __m128 v = _mm_cvtepi32_ps(i);
+        __m128 a = _mm_shuffle_ps(v, v, 0xff);
+        const __m128 scale = _mm_setr_ps(1.0f / 255, 1.0f / 255, 1.0f / 255, 0.0f);
+        const __m128 keep = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+        return _mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(a, scale), keep));
+    }
+
+    inline uint32_t unpremultiply(vec4 v)
+    {
+        // divide by the alpha before clamping it: lanczos overshoots past
+        // 255 and the colours overshoot with it
+        const float a = _mm_cvtss_f32(_mm_shuffle_ps(v, v, 0xff));
+        if (a < 0.5f)
+        {
+            return 0;
+        }
+        const float f = 255.0f / a;
+        v = _mm_mul_ps(v, _mm_setr_ps(f, f, f, 1.0f));
+        v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+        __m128i i = _mm_cvtps_epi32(v);
+        i = _mm_packs_epi32(i, i);
+        return _mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+    }
+#else
+    struct vec4
+    {
+        float v[4];
+    };
+
+    inline vec4 vzero() { return vec4{{0, 0, 0, 0}}; }
+    inline vec4 vload(const float *p) { return vec4{{p[0], p[1], p[2], p[3]}}; }
+    inline void vstore(float *p, vec4 v) { memcpy(p, v.v, sizeof(v.v)); }
+    inline vec4 vmadd(vec4 acc, vec4 v, float w)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            acc.v[i] += v.v[i] * w;
+        }
+        return acc;
+    }
+
+    inline vec4 premultiply(uint32_t c)
+    {
+        const float a = float(c >> 24);
+        const float f = a / 255;
+        return vec4{{(c & 0xff) * f, ((c >> 8) & 0xff) * f, ((c >> 16) & 0xff) * f, a}};
+    }
+
+    inline uint32_t unpremultiply(vec4 v)
+    {
+        const float a = v.v[3];
+        if (a < 0.5f)
+        {
+            return 0;
+        }
+        const float f = 255.0f / a;
+        uint32_t c = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const float x = i == 3 ? a : v.v[i] * f;
+            c |= uint32_t(lrintf(std::min(std::max(x, 0.0f), 255.0f))) << (i * 8);
+        }
+        return c;
+    }
+#endif
+
+    float boxKernel(float x)
+    {
+        return x > -0.5f && x <= 0.5f ? 1.0f : 0.0f;
+    }
+
+    float triangleKernel(float x)
+    {
+        x = fabsf(x);
+        return x < 1.0f ? 1.0f - x : 0.0f;
+    }
+
+    float sinc(float x)
+    {
+        if (x == 0.0f)
+        {
+            return 1.0f;
+        }
+        x *= PI;
+        return sinf(x) / x;
+    }
+
+    float lanczos3Kernel(float x)
+    {
+        return x > -3.0f && x < 3.0f ? sinc(x) * sinc(x / 3) : 0.0f;
+    }
+
+    // precomputed contributions of the source pixels to each output
+    // pixel along one axis: output i reads count[i] pixels from start[i]
+    // with weights coef[i * taps ...]
+    struct weights_t
+    {
+        int taps = 0;
+        std::vector<int> start;
+        std::vector<int> count;
+        std::vector<float> coef;
+
+        void compute(int src, int dst, float (*kernel)(float), float support)
+        {
+            const double scale = double(src) / dst;
+            const double fscale = std::max(scale, 1.0);
+            support *= fscale;
+            taps = int(ceil(support)) * 2 + 1;
+            start.resize(dst);
+            count.resize(dst);
+            coef.assign(size_t(dst) * taps, 0.0f);
+            for (int i = 0; i < dst; ++i)
+            {
+                const double center = (i + 0.5) * scale;
+                const int lo = std::max(int(center - support + 0.5), 0);
+                const int hi = std::min(int(center + support + 0.5), src);
+                float *w = &coef[size_t(i) * taps];
+                float sum = 0;
+                int n = 0;
+                for (int x = lo; x < hi && n < taps; ++x, ++n)
+                {
+                    w[n] = kernel(float((x - center + 0.5) / fscale));
+                    sum += w[n];
+                }
+                if (sum == 0.0f)
+                {
+                    // nothing in reach: fall back to the closest pixel
+                    start[i] = std::min(int(center), src - 1);
+                    count[i] = 1;
+                    w[0] = 1.0f;
+                    continue;
+                }
+                for (int k = 0; k < n; ++k)
+                {
+                    w[k] /= sum;
+                }
+                start[i] = lo;
+                count[i] = n;
+            }
+        }
+    };
+
+    void resampleNearest(const uint32_t *src, int srcStride, int srcLen, int srcHei,
+                         uint32_t *dst, int dstStride, int dstLen, int dstHei)
+    {
+        std::vector<int> xs(dstLen);
+        for (int x = 0; x < dstLen; ++x)
+        {
+            xs[x] = int(int64_t(x) * srcLen / dstLen);
+        }
+        int lastY = -1;
+        for (int y = 0; y < dstHei; ++y)
+        {
+            const int sy = int(int64_t(y) * srcHei / dstHei);
+            uint32_t *d = dst + size_t(y) * dstStride;
+            if (sy == lastY)
+            {
+                memcpy(d, d - dstStride, dstLen * sizeof(uint32_t));
+                continue;
+            }
+            const uint32_t *s = src + size_t(sy) * srcStride;
+            for (int x = 0; x < dstLen; ++x)
+            {
+                d[x] = s[xs[x]];
+            }
+            lastY = sy;
+        }
+    }
+
+    void resampleSeparable(const uint32_t *src, int srcStride, int srcLen, int srcHei,
+                           uint32_t *dst, int dstStride, int dstLen, int dstHei,
+                           float (*kernel)(float), float support)
+    {
+        weights_t wx;
+        weights_t wy;
+        wx.compute(srcLen, dstLen, kernel, support);
+        wy.compute(srcHei, dstHei, kernel, support);
+
+        // the last wy.taps source rows, filtered horizontally; row r is
+        // kept in slot r % wy.taps
+        const int ringSize = wy.taps;
+        std::vector<float> ring(size_t(ringSize) * dstLen * 4);
+        std::vector<float> line(size_t(srcLen) * 4);
+        std::vector<float> acc(size_t(dstLen) * 4);
+        int next = 0;
+
+        for (int y = 0; y < dstHei; ++y)
+        {
+            const int y0 = wy.start[y];
+            const int y1 = y0 + wy.count[y];
+            for (; next < y1; ++next)
+            {
+                const uint32_t *s = src + size_t(next) * srcStride;
+                for (int x = 0; x < srcLen; ++x)
+                {
+                    vstore(&line[size_t(x) * 4], premultiply(s[x]));
+                }
+                float *out = &ring[size_t(next % ringSize) * dstLen * 4];
+                for (int x = 0; x < dstLen; ++x)
+                {
+                    const float *w = &wx.coef[size_t(x) * wx.taps];
+                    const float *p = &line[size_t(wx.start[x]) * 4];
+                    vec4 a = vzero();
+                    for (int k = 0; k < wx.count[x]; ++k)
+                    {
+                        a = vmadd(a, vload(p + k * 4), w[k]);
+                    }
+                    vstore(out + size_t(x) * 4, a);
+                }
+            }
+
+            const float *w = &wy.coef[size_t(y) * wy.taps];
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int k = 0; k < y1 - y0; ++k)
+            {
+                const float *in = &ring[size_t((y0 + k) % ringSize) * dstLen * 4];
+                for (int x = 0; x < dstLen; ++x)
+                {
+                    vstore(&acc[size_t(x) * 4], vmadd(vload(&acc[size_t(x) * 4]), vload(in + size_t(x) * 4), w[k]));
+                }
+            }
+            uint32_t *d = dst + size_t(y) * dstStride;
+            for (int x = 0; x < dstLen; ++x)
+            {
+                d[x] = unpremultiply(vload(&acc[size_t(x) * 4]));
+            }
+        }
+    }
+
+    // scale2x / EPX: every pixel becomes 2x2, corners taking the colour
+    // of two matching neighbours so diagonal edges stay sharp
+    void scale2x(const uint32_t *src, int srcStride, int len, int hei, uint32_t *dst)
+    {
+        const int dstStride = len * 2;
+        for (int y = 0; y < hei; ++y)
+        {
+            const uint32_t *row = src + size_t(y) * srcStride;
+            const uint32_t *up = y > 0 ? row - srcStride : row;
+            const uint32_t *down = y < hei - 1 ? row + srcStride : row;
+            uint32_t *d0 = dst + size_t(y) * 2 * dstStride;
+            uint32_t *d1 = d0 + dstStride;
+            for (int x = 0; x < len; ++x)
+            {
+                const uint32_t p = row[x];
+                const uint32_t a = up[x];
+                const uint32_t d = down[x];
+                const uint32_t c = row[x > 0 ? x - 1 : x];
+                const uint32_t b = row[x < len - 1 ? x + 1 : x];
+                if (a != d && c != b)
+                {
+                    d0[x * 2] = c == a ? a : p;
+                    d0[x * 2 + 1] = a == b ? b : p;
+                    d1[x * 2] = c == d ? c : p;
+                    d1[x * 2 + 1] = d == b ? d : p;
+                }
+                else
+                {
+                    d0[x * 2] = d0[x * 2 + 1] = d1[x * 2] = d1[x * 2 + 1] = p;
+                }
+            }
+        }
+    }
+
+    void resampleScale2x(const uint32_t *src, int srcStride, int srcLen, int srcHei,
+                         uint32_t *dst, int dstStride, int dstLen, int dstHei)
+    {
+        std::vector<uint32_t> cur;
+        std::vector<uint32_t> tmp;
+        const uint32_t *s = src;
+        int stride = srcStride;
+        int len = srcLen;
+        int hei = srcHei;
+        while (len * 2 <= dstLen && hei * 2 <= dstHei)
+        {
+            tmp.resize(size_t(len) * hei * 4);
+            scale2x(s, stride, len, hei, tmp.data());
+            cur.swap(tmp);
+            s = cur.data();
+            len *= 2;
+            hei *= 2;
+            stride = len;
+        }
+        resampleNearest(s, stride, len, hei, dst, dstStride, dstLen, dstHei);
+    }
+}
+
+const char *resampleFilterName(int filter)
+{
+    return filter >= 0 && filter < RESAMPLE_FILTER_COUNT ? FILTER_NAMES[filter] : nullptr;
+}
+
+int resampleFilterFromName(const char *name)
+{
+    for (int i = 0; name && i < RESAMPLE_FILTER_COUNT; ++i)
+    {
+        if (strcmp(name, FILTER_NAMES[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool resample(const uint32_t *src, int srcStride, int srcLen, int srcHei,
+              uint32_t *dst, int dstStride, int dstLen, int dstHei, int filter)
+{
+    if (srcLen < 1 || srcHei < 1 || dstLen < 1 || dstHei < 1)
+    {
+        return false;
+    }
+
+    switch (filter)
+    {
+    case RESAMPLE_NEAREST:
+        resampleNearest(src, srcStride, srcLen, srcHei, dst, dstStride, dstLen, dstHei);
+        break;
+    case RESAMPLE_BOX:
+        resampleSeparable(src, srcStride, srcLen, srcHei, dst, dstStride, dstLen, dstHei, boxKernel, 0.5f);
+        break;
+    case RESAMPLE_BILINEAR:
+        resampleSeparable(src, srcStride, srcLen, srcHei, dst, dstStride, dstLen, dstHei, triangleKernel, 1.0f);
+        break;
+    case RESAMPLE_LANCZOS3:
+        resampleSeparable(src, srcStride, srcLen, srcHei, dst, dstStride, dstLen, dstHei, lanczos3Kernel, 3.0f);
+        break;
+    case RESAMPLE_SCALE2X:
+        resampleScale2x(src, srcStride, srcLen, srcHei, dst, dstStride, dstLen, dstHei);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stdint.h>
+
+// Separable image resampler on rgba buffers (A in the high byte; the
+// other three channels are treated alike). Filter weights are computed
+// once per axis, colours are filtered premultiplied by alpha, and the
+// inner loops use SSE2 when the target has it. No Qt, no allocation
+// beyond a few rows of scratch space.
+
+enum : int
+{
+    RESAMPLE_NEAREST,  // top-left aligned: a 2x enlarge duplicates pixels, a 2x shrink keeps the even ones
+    RESAMPLE_BOX,      // area average when shrinking
+    RESAMPLE_BILINEAR, // triangle filter
+    RESAMPLE_LANCZOS3, // windowed sinc, 3 lobes
+    RESAMPLE_SCALE2X,  // pixel art: scale2x (EPX) doublings, then nearest for the rest
+    RESAMPLE_FILTER_COUNT
+};
+
+// "nearest", "box", "bilinear", "lanczos3", "scale2x" (nullptr if unknown)
+const char *resampleFilterName(int filter);
+
+// reverse of resampleFilterName(); -1 if unknown
+int resampleFilterFromName(const char *name);
+
+// resample src (srcLen x srcHei) into dst (dstLen x dstHei); strides are
+// in pixels. src and dst must not overlap. Returns false when a size is
+// empty or the filter is unknown.
+bool resample(const uint32_t *src, int srcStride, int srcLen, int srcHei,
+              uint32_t *dst, int dstStride, int dstLen, int dstHei, int filter);
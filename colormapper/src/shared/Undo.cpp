@@ -0,0 +1,189 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Undo.h"
+#include "Frame.h"
+#include <algorithm>
+#include <string.h>
+
+CUndo::tile_t::tile_t(size_t *counter, size_t pixels)
+    : rgb(pixels), counter(counter)
+{
+    *counter += pixels * sizeof(uint32_t);
+}
+
+CUndo::tile_t::~tile_t()
+{
+    *counter -= rgb.size() * sizeof(uint32_t);
+}
+
+CUndo::CUndo(size_t budget, int tileSize)
+{
+    m_size = 0;
+    m_budget = budget;
+    m_tileSize = std::max(tileSize, 1);
+}
+
+CUndo::~CUndo()
+{
+    clear();
+}
+
+void CUndo::clear()
+{
+    m_undo.clear();
+    m_redo.clear();
+}
+
+CUndo::snapshot_t CUndo::snapshot(const CFrame &frame, const snapshot_t *ref)
+{
+    snapshot_t snap;
+    snap.len = frame.len();
+    snap.hei = frame.hei();
+    // tiles can only be shared between snapshots of the same size
+    if (ref && (ref->len != snap.len || ref->hei != snap.hei))
+    {
+        ref = nullptr;
+    }
+
+    const int ts = m_tileSize;
+    const int cols = (snap.len + ts - 1) / ts;
+    const int rows = (snap.hei + ts - 1) / ts;
+    snap.tiles.reserve(cols * rows);
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        for (int tx = 0; tx < cols; ++tx)
+        {
+            const CFrameView view = frame.view(tx * ts, ty * ts, ts, ts);
+            const size_t rowBytes = view.len() * sizeof(uint32_t);
+            if (ref)
+            {
+                const tilePtr_t &old = ref->tiles[snap.tiles.size()];
+                bool same = true;
+                for (int y = 0; same && y < view.hei(); ++y)
+                {
+                    same = !memcmp(view.row(y), old->rgb.data() + y * view.len(), rowBytes);
+                }
+                if (same)
+                {
+                    snap.tiles.push_back(old);
+                    continue;
+                }
+            }
+            auto tile = std::make_shared<tile_t>(&m_size, (size_t)view.len() * view.hei());
+            for (int y = 0; y < view.hei(); ++y)
+            {
+                memcpy(tile->rgb.data() + y * view.len(), view.row(y), rowBytes);
+            }
+            snap.tiles.push_back(std::move(tile));
+        }
+    }
+    return snap;
+}
+
+void CUndo::restore(CFrame &frame, const snapshot_t &snap)
+{
+    if (frame.len() != snap.len || frame.hei() != snap.hei)
+    {
+        frame.resize(snap.len, snap.hei);
+    }
+
+    const int ts = m_tileSize;
+    const int cols = (snap.len + ts - 1) / ts;
+    for (size_t i = 0; i < snap.tiles.size(); ++i)
+    {
+        const CFrameView view = frame.view((i % cols) * ts, (i / cols) * ts, ts, ts);
+        const uint32_t *rgb = snap.tiles[i]->rgb.data();
+        for (int y = 0; y < view.hei(); ++y)
+        {
+            memcpy(view.row(y), rgb + y * view.len(), view.len() * sizeof(uint32_t));
+        }
+    }
+    frame.invalidateMap();
+}
+
+void CUndo::trim()
+{
+    // always keep the latest step
+    while (m_budget && m_size > m_budget && m_undo.size() > 1)
+    {
+        m_undo.pop_front();
+    }
+}
+
+void CUndo::push(const CFrame &frame)
+{
+    m_redo.clear();
+    m_undo.push_back(snapshot(frame, m_undo.empty() ? nullptr : &m_undo.back()));
+    trim();
+}
+
+bool CUndo::undo(CFrame &frame)
+{
+    if (m_undo.empty())
+    {
+        return false;
+    }
+    m_redo.push_back(snapshot(frame, &m_undo.back()));
+    restore(frame, m_undo.back());
+    m_undo.pop_back();
+    return true;
+}
+
+bool CUndo::redo(CFrame &frame)
+{
+    if (m_redo.empty())
+    {
+        return false;
+    }
+    m_undo.push_back(snapshot(frame, &m_redo.back()));
+    restore(frame, m_redo.back());
+    m_redo.pop_back();
+    return true;
+}
+
+bool CUndo::canUndo() const
+{
+    return !m_undo.empty();
+}
+
+bool CUndo::canRedo() const
+{
+    return !m_redo.empty();
+}
+
+void CUndo::setBudget(size_t budget)
+{
+    m_budget = budget;
+    trim();
+}
+
+size_t CUndo::budget() const
+{
+    return m_budget;
+}
+
+size_t CUndo::size() const
+{
+    return m_size;
+}
+
+int CUndo::depth() const
+{
+    return m_undo.size();
+}
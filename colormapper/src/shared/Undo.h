@@ -0,0 +1,91 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class CFrame;
+
+// CUndo : undo/redo history for a CFrame
+//
+// Each snapshot is a grid of tiles. A tile that matches the one in the
+// previous snapshot is shared rather than copied, so a snapshot only
+// costs the tiles that changed. The oldest undo steps are dropped once
+// the tiles held exceed the memory budget.
+
+class CUndo
+{
+public:
+    CUndo(size_t budget = DEFAULT_BUDGET, int tileSize = DEFAULT_TILE_SIZE);
+    ~CUndo();
+    CUndo(const CUndo &) = delete;
+    CUndo &operator=(const CUndo &) = delete;
+
+    void push(const CFrame &frame);
+    bool undo(CFrame &frame);
+    bool redo(CFrame &frame);
+    bool canUndo() const;
+    bool canRedo() const;
+    void clear();
+
+    // 0: unlimited
+    void setBudget(size_t budget);
+    size_t budget() const;
+    // bytes held by the tiles of every snapshot
+    size_t size() const;
+    int depth() const;
+
+    enum
+    {
+        DEFAULT_BUDGET = 64 * 1024 * 1024,
+        DEFAULT_TILE_SIZE = 64
+    };
+
+protected:
+    struct tile_t
+    {
+        tile_t(size_t *counter, size_t pixels);
+        ~tile_t();
+        std::vector<uint32_t> rgb;
+        size_t *counter;
+    };
+
+    typedef std::shared_ptr<const tile_t> tilePtr_t;
+
+    typedef struct
+    {
+        int len;
+        int hei;
+        std::vector<tilePtr_t> tiles;
+    } snapshot_t;
+
+    snapshot_t snapshot(const CFrame &frame, const snapshot_t *ref);
+    void restore(CFrame &frame, const snapshot_t &snap);
+    void trim();
+
+    size_t m_size;
+    size_t m_budget;
+    int m_tileSize;
+    std::deque<snapshot_t> m_undo;
+    std::deque<snapshot_t> m_redo;
+};
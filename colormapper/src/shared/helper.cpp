@@ -20,6 +20,12 @@
 #include <cstdio>
 #include <zlib.h>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include "helper.h"
 #ifdef USE_QFILE
 #define FILEWRAP QFileWrap
@@ -154,6 +160,109 @@ int compressData(unsigned char *in_data, unsigned long in_size, unsigned char **
         Z_DEFAULT_COMPRESSION);
 }
 
+int compressDataParallel(unsigned char *in_data, unsigned long in_size, unsigned char **out_data, unsigned long &out_size, int level, int threads)
+{
+    enum : unsigned long
+    {
+        BLOCK_SIZE = 128 * 1024,
+        WINDOW_SIZE = 32 * 1024
+    };
+
+    int blocks = (in_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (threads == 1 || blocks < 2)
+    {
+        out_size = ::compressBound(in_size);
+        *out_data = new unsigned char[out_size];
+        return ::compress2(*out_data, &out_size, in_data, in_size, level);
+    }
+
+    // pigz-style: every block is a raw deflate stream primed with the
+    // previous 32K of input and ended on a byte boundary (sync flush), so
+    // the blocks concatenate into one stream; the last block finishes it
+    std::vector<std::vector<unsigned char>> packed(blocks);
+    std::vector<uLong> check(blocks);
+    std::vector<int> errs(blocks, Z_OK);
+    parallelFor(blocks, [&](int i) {
+        unsigned long start = i * BLOCK_SIZE;
+        unsigned long size = std::min((unsigned long)BLOCK_SIZE, in_size - start);
+        bool last = i == blocks - 1;
+        check[i] = adler32(adler32(0L, Z_NULL, 0), in_data + start, size);
+
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        int err = deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (err != Z_OK)
+        {
+            errs[i] = err;
+            return;
+        }
+        if (start)
+        {
+            unsigned long dict = std::min((unsigned long)WINDOW_SIZE, start);
+            err = deflateSetDictionary(&zs, in_data + start - dict, dict);
+        }
+        if (err == Z_OK)
+        {
+            // the sync flush marker is not covered by deflateBound
+            packed[i].resize(deflateBound(&zs, size) + 16);
+            zs.next_in = in_data + start;
+            zs.avail_in = size;
+            zs.next_out = packed[i].data();
+            zs.avail_out = packed[i].size();
+            err = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+            if ((last && err == Z_STREAM_END) || (!last && err == Z_OK && !zs.avail_in))
+            {
+                err = Z_OK;
+                packed[i].resize(zs.total_out);
+            }
+            else if (err == Z_OK)
+            {
+                err = Z_BUF_ERROR;
+            }
+        }
+        deflateEnd(&zs);
+        errs[i] = err;
+    }, threads);
+
+    out_size = 2 + 4;
+    for (int i = 0; i < blocks; ++i)
+    {
+        if (errs[i] != Z_OK)
+        {
+            *out_data = nullptr;
+            out_size = 0;
+            return errs[i];
+        }
+        out_size += packed[i].size();
+    }
+
+    // zlib header (same FLEVEL hint as deflate would write)
+    int flevel = level == Z_DEFAULT_COMPRESSION ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3)));
+    int header = ((Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8) | (flevel << 6);
+    header += 31 - header % 31;
+
+    unsigned char *out = new unsigned char[out_size];
+    *out_data = out;
+    *out++ = header >> 8;
+    *out++ = header & 0xff;
+    uLong adler = check[0];
+    for (int i = 0; i < blocks; ++i)
+    {
+        if (i)
+        {
+            unsigned long size = std::min((unsigned long)BLOCK_SIZE, in_size - i * BLOCK_SIZE);
+            adler = adler32_combine(adler, check[i], size);
+        }
+        memcpy(out, packed[i].data(), packed[i].size());
+        out += packed[i].size();
+    }
+    *out++ = adler >> 24;
+    *out++ = (adler >> 16) & 0xff;
+    *out++ = (adler >> 8) & 0xff;
+    *out++ = adler & 0xff;
+    return Z_OK;
+}
+
 uint64_t getFileSize(const std::string &filename)
 {
     try
@@ -165,3 +274,150 @@ uint64_t getFileSize(const std::string &filename)
         throw std::runtime_error("Error accessing file: " + std::string(e.what()));
     }
 }
+
+namespace
+{
+    // one parallelFor call; the caller works on it alongside the helpers
+    struct job_t
+    {
+        const std::function<void(int)> *fn;
+        int count;
+        std::atomic<int> next{0};
+        int slots;  // helpers still wanted
+        int active; // helpers working on it
+        std::condition_variable done;
+
+        void work()
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                (*fn)(i);
+            }
+        }
+    };
+
+    // worker threads started on first use and kept until exit, so that
+    // parallelFor does not pay for creating threads on every call
+    class CWorkerPool
+    {
+    public:
+        CWorkerPool()
+        {
+            const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+            for (int i = 1; i < cores; ++i)
+            {
+                m_threads.emplace_back(&CWorkerPool::loop, this);
+            }
+        }
+
+        ~CWorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto &thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        static CWorkerPool &instance()
+        {
+            static CWorkerPool pool;
+            return pool;
+        }
+
+        int size() const
+        {
+            return m_threads.size();
+        }
+
+        void run(int count, const std::function<void(int)> &fn, int helpers)
+        {
+            job_t job;
+            job.fn = &fn;
+            job.count = count;
+            job.slots = helpers;
+            job.active = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(&job);
+            }
+            for (int i = 0; i < helpers; ++i)
+            {
+                m_wake.notify_one();
+            }
+
+            job.work();
+
+            // helpers that have not picked the job up by now are not needed;
+            // a nested call on a busy pool simply runs on the caller
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+            if (it != m_jobs.end())
+            {
+                m_jobs.erase(it);
+            }
+            job.done.wait(lock, [&job] { return job.active == 0; });
+        }
+
+    private:
+        void loop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+                if (m_stop)
+                {
+                    return;
+                }
+                job_t *job = m_jobs.front();
+                if (--job->slots == 0)
+                {
+                    m_jobs.pop_front();
+                }
+                ++job->active;
+                lock.unlock();
+                job->work();
+                lock.lock();
+                if (--job->active == 0)
+                {
+                    job->done.notify_all();
+                }
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<job_t *> m_jobs;
+        std::vector<std::thread> m_threads;
+        bool m_stop = false;
+    };
+}
+
+void parallelFor(int count, const std::function<void(int)> &fn, int threads)
+{
+    if (threads <= 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = std::max(1, std::min(threads, count));
+    if (threads > 1)
+    {
+        // the caller takes one share; helpers come from the shared pool
+        CWorkerPool &pool = CWorkerPool::instance();
+        const int helpers = std::min(threads - 1, pool.size());
+        if (helpers)
+        {
+            pool.run(count, fn, helpers);
+            return;
+        }
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        fn(i);
+    }
+}
@@ -20,6 +20,7 @@
 #include <list>
 #include <vector>
 #include <list>
+#include <functional>
 const char *toUpper(char *s);
 char *getUUID();
 bool copyFile(const std::string in, const std::string out, std::string &errMsg);
@@ -31,4 +32,9 @@ int upperClean(int c);
 // #include <linux/limits.h>
 #endif
 int compressData(unsigned char *in_data, unsigned long in_size, unsigned char **out_data, unsigned long &out_size);
-uint64_t getFileSize(const std::string &filename);
\ No newline at end of file
+// zlib stream deflated as independent blocks on worker threads (0 = one per core)
+int compressDataParallel(unsigned char *in_data, unsigned long in_size, unsigned char **out_data, unsigned long &out_size, int level, int threads);
+uint64_t getFileSize(const std::string &filename);
+// run fn(0..count-1) across worker threads (0 = one per core); the
+// threads come from a pool created on first use and shared by all calls
+void parallelFor(int count, const std::function<void(int)> &fn, int threads = 0);
@@ -74,8 +74,11 @@ QFileWrap & QFileWrap::operator >> ( std::string & str)
     int x = 0;
     read (&x, 1);
     if (x == 0xff) {
+        x = 0;
         read (&x, 2);
-        // TODO: implement 32 bits version
+        if (x == 0xffff) {
+            read (&x, 4);
+        }
     }
 
     if (x != 0) {
@@ -100,9 +103,14 @@ QFileWrap & QFileWrap::operator << (const std::string & str)
     else {
         int t = 0xff;
         write (&t, 1);
-        write (&x, 2);
-
-        // TODO : implement 32bits version
+        if (x < 0xffff) {
+            write (&x, 2);
+        } else {
+            // 0xffff escapes to a 32 bits length
+            t = 0xffff;
+            write (&t, 2);
+            write (&x, 4);
+        }
     }
 
     if (x!=0) {
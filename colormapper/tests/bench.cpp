@@ -0,0 +1,424 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "CRC.h"
+#include "FileMap.h"
+#include "FileWrap.h"
+#include "FrameSet.h"
+#include "PixelOps.h"
+#include "PngFilter.h"
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// Microbenchmarks for the SIMD kernels and their scalar references. Not a
+// test: run by hand, optionally with name prefixes to pick benchmarks
+// (bench unfilter crc).
+
+namespace
+{
+    struct bench_t
+    {
+        std::string name;
+        size_t bytes; // processed per run, for the throughput column
+        std::function<void()> run;
+    };
+
+    std::vector<uint8_t> makeData(size_t size, uint32_t seed)
+    {
+        std::vector<uint8_t> data(size);
+        for (auto &c : data)
+        {
+            seed = seed * 1103515245 + 12345;
+            c = seed >> 24;
+        }
+        return data;
+    }
+
+    std::vector<std::string> g_tempFiles;
+
+    // best time of a few rounds of at least 50 ms each
+    double measure(const std::function<void()> &run)
+    {
+        typedef std::chrono::steady_clock clock;
+        run();
+        double best = 1e30;
+        for (int round = 0; round < 3; ++round)
+        {
+            int count = 0;
+            const clock::time_point start = clock::now();
+            double ms;
+            do
+            {
+                run();
+                ++count;
+                ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            } while (ms < 50);
+            best = std::min(best, ms / count);
+        }
+        return best;
+    }
+
+    // image sized scanlines for the PNG filter kernels
+    enum
+    {
+        ROW_BYTES = 4096 * 4,
+        ROWS = 256
+    };
+
+    void addUnfilter(std::vector<bench_t> &benches)
+    {
+        static const std::vector<uint8_t> image = makeData(ROW_BYTES * (ROWS + 1), 1);
+        static std::vector<uint8_t> rows;
+        const char *names[] = {"none", "sub", "up", "average", "paeth"};
+        for (int bpp : {3, 4, 6})
+        {
+            for (uint8_t filter = PNG_FILTER_SUB; filter < PNG_FILTER_COUNT; ++filter)
+            {
+                const std::string name = std::string("unfilter/") + names[filter] + "/bpp" + std::to_string(bpp);
+                const auto unfilter = [filter, bpp](bool scalar) {
+                    rows = image;
+                    for (int y = 1; y <= ROWS; ++y)
+                    {
+                        uint8_t *row = &rows[y * ROW_BYTES];
+                        if (scalar)
+                        {
+                            pngUnfilterRowScalar(filter, row, row - ROW_BYTES, ROW_BYTES, bpp);
+                        }
+                        else
+                        {
+                            pngUnfilterRow(filter, row, row - ROW_BYTES, ROW_BYTES, bpp);
+                        }
+                    }
+                };
+                benches.push_back({name, ROW_BYTES * ROWS, [unfilter]() { unfilter(false); }});
+                benches.push_back({name + "/scalar", ROW_BYTES * ROWS, [unfilter]() { unfilter(true); }});
+            }
+        }
+    }
+
+    void addFilter(std::vector<bench_t> &benches)
+    {
+        static const std::vector<uint8_t> image = makeData(ROW_BYTES * (ROWS + 1), 2);
+        static std::vector<uint8_t> out(ROW_BYTES);
+        const char *names[] = {"none", "sub", "up", "average", "paeth"};
+        for (uint8_t filter = PNG_FILTER_NONE; filter < PNG_FILTER_COUNT; ++filter)
+        {
+            const std::string name = std::string("filter/") + names[filter];
+            const auto run = [filter](bool scalar) {
+                for (int y = 1; y <= ROWS; ++y)
+                {
+                    const uint8_t *row = &image[y * ROW_BYTES];
+                    if (scalar)
+                    {
+                        pngFilterRowScalar(filter, out.data(), row, row - ROW_BYTES, ROW_BYTES, 4);
+                    }
+                    else
+                    {
+                        pngFilterRow(filter, out.data(), row, row - ROW_BYTES, ROW_BYTES, 4);
+                    }
+                }
+            };
+            benches.push_back({name, ROW_BYTES * ROWS, [run]() { run(false); }});
+            benches.push_back({name + "/scalar", ROW_BYTES * ROWS, [run]() { run(true); }});
+        }
+
+        // toPng()'s per-row selection modes
+        for (int mode : {PNG_FILTER_ADAPTIVE, PNG_FILTER_FAST})
+        {
+            const std::string name = mode == PNG_FILTER_ADAPTIVE ? "filter/select/adaptive" : "filter/select/fast";
+            const auto run = [mode]() {
+                for (int y = 1; y <= ROWS; ++y)
+                {
+                    const uint8_t *row = &image[y * ROW_BYTES];
+                    pngSelectFilter(mode, out.data(), row, row - ROW_BYTES, ROW_BYTES, 4);
+                }
+            };
+            benches.push_back({name, ROW_BYTES * ROWS, run});
+        }
+    }
+
+    // CCRC's dispatch and its slicing-by-8 fallback next to zlib, on chunk
+    // header sized buffers and on a whole IDAT
+    void addCrc(std::vector<bench_t> &benches)
+    {
+        static const std::vector<uint8_t> data = makeData(1 << 20, 3);
+        static volatile uint32_t sink;
+        for (size_t size : {size_t(64), data.size()})
+        {
+            const std::string name = "crc/" + std::to_string(size);
+            const size_t count = data.size() / size;
+            benches.push_back({name, data.size(), [size, count]() {
+                                   for (size_t i = 0; i < count; ++i)
+                                   {
+                                       sink = CCRC::crc(&data[i * size], size);
+                                   }
+                               }});
+            benches.push_back({name + "/slice8", data.size(), [size, count]() {
+                                   for (size_t i = 0; i < count; ++i)
+                                   {
+                                       sink = CCRC::update_slice8(0xffffffff, &data[i * size], size) ^ 0xffffffff;
+                                   }
+                               }});
+            benches.push_back({name + "/zlib", data.size(), [size, count]() {
+                                   for (size_t i = 0; i < count; ++i)
+                                   {
+                                       sink = crc32(0, &data[i * size], size);
+                                   }
+                               }});
+        }
+    }
+
+    // PixelOps kernels next to the per-pixel loops CFrame used before them
+    void addPixelOps(std::vector<bench_t> &benches)
+    {
+        enum : size_t
+        {
+            COUNT = 1024 * 1024,
+            BYTES = COUNT * 4
+        };
+        static std::vector<uint32_t> pixels(COUNT);
+        static std::vector<uint32_t> opaque(COUNT, 0xff808080);
+        static std::vector<uint32_t> clear(COUNT, 0x00808080);
+        static uint8_t lut[256];
+        static volatile bool sink;
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            // runs of opaque and clear pixels, as in sprites
+            pixels[i] = (i * 2654435761u) >> 8 | ((i / 37) % 3 ? 0xff000000 : 0);
+        }
+        for (int i = 0; i < 256; ++i)
+        {
+            // a permutation, so repeated runs keep the alpha mix
+            lut[i] = 255 - i;
+        }
+        uint32_t *rgb = pixels.data();
+
+        const auto add = [&benches](const char *name, std::function<void()> kernel, std::function<void()> scalar) {
+            benches.push_back({std::string("pixel/") + name, BYTES, kernel});
+            benches.push_back({std::string("pixel/") + name + "/scalar", BYTES, scalar});
+        };
+        add(
+            "fill", [rgb]() { pixelFill(rgb, COUNT, 0xff00ff00); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    rgb[i] = 0xff00ff00;
+                }
+            });
+        add(
+            "inverse", [rgb]() { pixelInverse(rgb, COUNT); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    rgb[i] = (~rgb[i] & 0xffffff) + (rgb[i] & 0xff000000);
+                }
+            });
+        add(
+            "mapAlpha", [rgb]() { pixelMapAlpha(rgb, COUNT, lut); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    rgb[i] = (rgb[i] & 0xffffff) + (lut[rgb[i] >> 24] << 24);
+                }
+            });
+        add(
+            "swapRB", [rgb]() { pixelSwapRB(rgb, COUNT); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    uint32_t t = (rgb[i] & 0xff00ff00);
+                    if (t & 0xff000000)
+                    {
+                        t += ((rgb[i] & 0xff) << 16) + ((rgb[i] & 0xff0000) >> 16);
+                    }
+                    rgb[i] = t;
+                }
+            });
+        add(
+            "swapGB", [rgb]() { pixelSwapGB(rgb, COUNT); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    uint32_t t = (rgb[i] & 0xff0000ff);
+                    if (t & 0xff000000)
+                    {
+                        t += ((rgb[i] & 0xff00) << 8) + ((rgb[i] & 0xff0000) >> 8);
+                    }
+                    rgb[i] = t;
+                }
+            });
+        add(
+            "clearColor", [rgb]() { pixelClearColor(rgb, COUNT, 0x123456); },
+            [rgb]() {
+                for (size_t i = 0; i < COUNT; ++i)
+                {
+                    if ((rgb[i] & 0xffffff) == 0x123456)
+                    {
+                        rgb[i] = 0;
+                    }
+                }
+            });
+
+        // the scans only finish early on a hit, so time them without one
+        add(
+            "anyTransparent", []() { sink = pixelAnyTransparent(opaque.data(), COUNT); },
+            []() {
+                bool any = false;
+                for (size_t i = 0; i < COUNT && !any; ++i)
+                {
+                    any = !(opaque[i] & 0xff000000);
+                }
+                sink = any;
+            });
+        add(
+            "anyOpaque", []() { sink = pixelAnyOpaque(clear.data(), COUNT); },
+            []() {
+                bool any = false;
+                for (size_t i = 0; i < COUNT && !any; ++i)
+                {
+                    any = (clear[i] & 0xff000000) != 0;
+                }
+                sink = any;
+            });
+    }
+
+    void put32(std::vector<uint8_t> &out, uint32_t v)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            out.push_back(v >> shift);
+        }
+    }
+
+    void putChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data)
+    {
+        put32(out, data.size());
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put32(out, crc32(0, &out[start], out.size() - start));
+    }
+
+    // noise image with unfiltered rows in stored deflate blocks, so the
+    // decode time is mostly the row converter
+    std::string makePng(int colorType, int depth, int size)
+    {
+        const int channels = colorType == 2 ? 3 : colorType == 4 ? 2 : colorType == 6 ? 4 : 1;
+        const int rowBytes = (size * channels * depth + 7) / 8;
+        std::vector<uint8_t> raw = makeData((rowBytes + 1) * size, colorType * 100 + depth);
+        for (int y = 0; y < size; ++y)
+        {
+            raw[y * (rowBytes + 1)] = PNG_FILTER_NONE;
+        }
+        uLongf packedSize = compressBound(raw.size());
+        std::vector<uint8_t> packed(packedSize);
+        compress2(packed.data(), &packedSize, raw.data(), raw.size(), Z_NO_COMPRESSION);
+        packed.resize(packedSize);
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<uint8_t> ihdr;
+        put32(ihdr, size);
+        put32(ihdr, size);
+        ihdr.insert(ihdr.end(), {(uint8_t)depth, (uint8_t)colorType, 0, 0, 0});
+        putChunk(png, "IHDR", ihdr);
+        if (colorType == 3)
+        {
+            putChunk(png, "PLTE", makeData(3 << depth, 3));
+        }
+        putChunk(png, "IDAT", packed);
+        putChunk(png, "IEND", {});
+
+        const std::string path = tempPath(("bench_" + std::to_string(colorType) + "_" + std::to_string(depth) + ".png").c_str());
+        CFileWrap file;
+        file.open(path.c_str(), "wb");
+        file.write(png.data(), png.size());
+        file.close();
+        return path;
+    }
+
+    void addDecode(std::vector<bench_t> &benches)
+    {
+        enum
+        {
+            SIZE = 1024
+        };
+        const struct
+        {
+            int colorType;
+            int depth;
+            const char *name;
+        } formats[] = {
+            {0, 1, "gray1"}, {0, 2, "gray2"}, {0, 4, "gray4"}, {0, 8, "gray8"}, {0, 16, "gray16"},
+            {2, 8, "rgb8"}, {2, 16, "rgb16"},
+            {3, 1, "palette1"}, {3, 2, "palette2"}, {3, 4, "palette4"}, {3, 8, "palette8"},
+            {4, 8, "grayalpha8"}, {4, 16, "grayalpha16"},
+            {6, 8, "rgba8"}, {6, 16, "rgba16"},
+        };
+        for (const auto &format : formats)
+        {
+            const std::string path = makePng(format.colorType, format.depth, SIZE);
+            g_tempFiles.push_back(path);
+            const auto decode = [path]() {
+                CFileMap file;
+                CFrameSet set;
+                if (!file.open(path.c_str(), "rb") || !set.extract(file))
+                {
+                    fprintf(stderr, "%s: %s\n", path.c_str(), set.getLastError());
+                }
+            };
+            // throughput in output pixels (4 bytes each)
+            benches.push_back({std::string("decode/") + format.name, SIZE * SIZE * 4, decode});
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<bench_t> benches;
+    addUnfilter(benches);
+    addFilter(benches);
+    addDecode(benches);
+    addPixelOps(benches);
+    addCrc(benches);
+
+    printf("%-32s %10s %10s\n", "benchmark", "ms", "MB/s");
+    for (const bench_t &bench : benches)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected |= bench.name.compare(0, strlen(argv[i]), argv[i]) == 0;
+        }
+        if (selected)
+        {
+            const double ms = measure(bench.run);
+            printf("%-32s %10.3f %10.1f\n", bench.name.c_str(), ms, bench.bytes / ms / 1000.0);
+        }
+    }
+
+    for (const std::string &path : g_tempFiles)
+    {
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Minimal checks for the standalone tests: failures are reported and
+// counted, and main() returns TEST_RESULT().
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                           \
+    do                                                                        \
+    {                                                                         \
+        if (!(cond))                                                          \
+        {                                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                    #cond);                                                   \
+            ++g_failures;                                                     \
+        }                                                                     \
+    } while (0)
+
+#define TEST_RESULT() (g_failures ? (fprintf(stderr, "%d failure(s)\n", g_failures), 1) : 0)
+
+// path for a scratch file in the system temp directory
+inline std::string tempPath(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
@@ -0,0 +1,71 @@
+//go:build ignore
+
+// Writes reference.inc: the decoded size and the CRC-32 of the rgba bytes
+// (8 bits per channel, 16 bit samples reduced to their high byte, colours
+// not premultiplied) of every PNG in this directory, as decoded by Go's
+// image/png. Run from this directory with: go run reference.go
+package main
+
+import (
+	"fmt"
+	"hash/crc32"
+	"image/color"
+	"image/png"
+	"os"
+	"path/filepath"
+	"sort"
+)
+
+func rgba(c color.Color) [4]uint8 {
+	switch c := c.(type) {
+	case color.NRGBA:
+		return [4]uint8{c.R, c.G, c.B, c.A}
+	case color.NRGBA64:
+		return [4]uint8{uint8(c.R >> 8), uint8(c.G >> 8), uint8(c.B >> 8), uint8(c.A >> 8)}
+	case color.Gray:
+		return [4]uint8{c.Y, c.Y, c.Y, 0xff}
+	case color.Gray16:
+		return [4]uint8{uint8(c.Y >> 8), uint8(c.Y >> 8), uint8(c.Y >> 8), 0xff}
+	case color.RGBA:
+		if c.A == 0xff {
+			return [4]uint8{c.R, c.G, c.B, c.A}
+		}
+	case color.RGBA64:
+		if c.A == 0xffff {
+			return [4]uint8{uint8(c.R >> 8), uint8(c.G >> 8), uint8(c.B >> 8), 0xff}
+		}
+	}
+	panic(fmt.Sprintf("unexpected colour %T %v", c, c))
+}
+
+func main() {
+	names, _ := filepath.Glob("*.png")
+	sort.Strings(names)
+	out, err := os.Create("reference.inc")
+	if err != nil {
+		panic(err)
+	}
+	defer out.Close()
+	fmt.Fprintln(out, "// generated by reference.go: file, width, height, crc32 of the rgba bytes")
+	for _, name := range names {
+		f, err := os.Open(name)
+		if err != nil {
+			panic(err)
+		}
+		img, err := png.Decode(f)
+		f.Close()
+		if err != nil {
+			panic(fmt.Sprintf("%s: %v", name, err))
+		}
+		b := img.Bounds()
+		crc := crc32.NewIEEE()
+		for y := b.Min.Y; y < b.Max.Y; y++ {
+			for x := b.Min.X; x < b.Max.X; x++ {
+				p := rgba(img.At(x, y))
+				crc.Write(p[:])
+			}
+		}
+		fmt.Fprintf(out, "{\"%s\", %d, %d, 0x%08x},\n", name, b.Dx(), b.Dy(), crc.Sum32())
+	}
+}
+
@@ -0,0 +1,92 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "CRC.h"
+#include <vector>
+#include <zlib.h>
+
+// CCRC (carry-less multiplication folding or slicing-by-8) against zlib's
+// crc32(), at every short length and alignment and across arbitrary splits
+
+namespace
+{
+    std::vector<uint8_t> makeData(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        uint32_t seed = 99;
+        for (auto &c : data)
+        {
+            seed = seed * 1103515245 + 12345;
+            c = seed >> 24;
+        }
+        return data;
+    }
+
+    uint32_t reference(const uint8_t *buf, size_t len)
+    {
+        return crc32(crc32(0, Z_NULL, 0), buf, len);
+    }
+
+    void testLengths(const std::vector<uint8_t> &data)
+    {
+        int bad = 0;
+        for (size_t offset = 0; offset < 16; ++offset)
+        {
+            for (size_t len = 0; len <= 300; ++len)
+            {
+                const uint8_t *buf = data.data() + offset;
+                const uint32_t expected = reference(buf, len);
+                bad += CCRC::crc(buf, len) != expected;
+                bad += (CCRC::update_slice8(0xffffffff, buf, len) ^ 0xffffffff) != expected;
+            }
+        }
+        CHECK(bad == 0);
+    }
+
+    void testSplits(const std::vector<uint8_t> &data)
+    {
+        const uint32_t expected = reference(data.data(), data.size());
+        uint32_t seed = 7;
+        int bad = 0;
+        for (int round = 0; round < 200; ++round)
+        {
+            // pieces from 0 to 511 bytes, so both kernels see every shape
+            unsigned long crc = 0xffffffff;
+            size_t pos = 0;
+            while (pos < data.size())
+            {
+                seed = seed * 1103515245 + 12345;
+                const size_t len = std::min<size_t>((seed >> 16) % 512, data.size() - pos);
+                crc = CCRC::update_crc(crc, data.data() + pos, len);
+                pos += len;
+            }
+            bad += (crc ^ 0xffffffff) != expected;
+        }
+        CHECK(bad == 0);
+    }
+}
+
+int main()
+{
+    const std::vector<uint8_t> data = makeData(64 * 1024 + 16);
+    testLengths(data);
+    testSplits(data);
+    CHECK(CCRC::crc(data.data(), data.size()) == reference(data.data(), data.size()));
+    CHECK(CCRC::crc(data.data(), -1) == 0);
+    return TEST_RESULT();
+}
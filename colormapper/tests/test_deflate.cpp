@@ -0,0 +1,119 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "FileWrap.h"
+#include "helper.h"
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+// compressDataParallel() output must be a plain zlib stream
+
+namespace
+{
+    // mix of runs and noise so blocks both match and miss across boundaries
+    std::vector<unsigned char> makeData(unsigned long size)
+    {
+        std::vector<unsigned char> data(size);
+        uint32_t seed = 12345;
+        for (unsigned long i = 0; i < size; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            data[i] = (i / 4096) & 1 ? (unsigned char)(seed >> 24) : (unsigned char)(i / 97);
+        }
+        return data;
+    }
+
+    void testRoundTrip(unsigned long size, int level, int threads)
+    {
+        std::vector<unsigned char> data = makeData(size);
+        unsigned char *packed = nullptr;
+        unsigned long packedSize = 0;
+        CHECK(compressDataParallel(data.data(), size, &packed, packedSize, level, threads) == Z_OK);
+
+        std::vector<unsigned char> out(size + 1);
+        uLongf outSize = out.size();
+        CHECK(uncompress(out.data(), &outSize, packed, packedSize) == Z_OK);
+        CHECK(outSize == size);
+        CHECK(memcmp(out.data(), data.data(), size) == 0);
+        delete[] packed;
+    }
+
+    void testPng(int threads, int level)
+    {
+        CFrame frame(640, 480);
+        std::vector<unsigned char> data = makeData(frame.len() * frame.hei() * sizeof(uint32_t));
+        memcpy(frame.getRGB(), data.data(), data.size());
+        for (int i = 0; i < frame.len() * frame.hei(); ++i)
+        {
+            frame.getRGB()[i] |= 0xff000000;
+        }
+
+        pngOptions_t options;
+        options.threads = threads;
+        options.level = level;
+        uint8_t *png = nullptr;
+        int size = 0;
+        frame.toPng(png, size, nullptr, 0, options);
+        CHECK(png != nullptr && size > 0);
+
+        const std::string path = tempPath("test_deflate.png");
+        CFileWrap file;
+        CHECK(file.open(path.c_str(), "wb"));
+        file.write(png, size);
+        file.close();
+        delete[] png;
+
+        CFrameSet set;
+        CHECK(file.open(path.c_str(), "rb"));
+        CHECK(set.extract(file));
+        file.close();
+        std::filesystem::remove(path);
+
+        CHECK(set.getSize() == 1);
+        if (set.getSize() == 1)
+        {
+            CFrame *decoded = set[0];
+            CHECK(decoded->len() == frame.len() && decoded->hei() == frame.hei());
+            CHECK(memcmp(decoded->getRGB(), frame.getRGB(), frame.len() * frame.hei() * sizeof(uint32_t)) == 0);
+        }
+    }
+}
+
+int main()
+{
+    const unsigned long sizes[] = {0, 1, 1000, 128 * 1024, 128 * 1024 + 1, 1000000};
+    const int levels[] = {Z_DEFAULT_COMPRESSION, Z_NO_COMPRESSION, 1, 9};
+    const int threads[] = {0, 1, 2, 4};
+    for (unsigned long size : sizes)
+    {
+        for (int level : levels)
+        {
+            for (int n : threads)
+            {
+                testRoundTrip(size, level, n);
+            }
+        }
+    }
+    testPng(4, Z_DEFAULT_COMPRESSION);
+    testPng(0, 9);
+    testPng(1, 1);
+    return TEST_RESULT();
+}
@@ -0,0 +1,82 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "FileMap.h"
+#include "FileWrap.h"
+#include <string>
+#include <vector>
+
+// strings written by CFileWrap read back through CFileWrap and CFileMap,
+// across the 8, 16 and 32 bits length encodings
+
+int main()
+{
+    const std::string path = tempPath("test_filemap.bin");
+    const size_t sizes[] = {0, 1, 0xfe, 0xff, 0x100, 0xfffe, 0xffff, 0x10000, 70000};
+    std::vector<std::string> strings;
+    for (size_t size : sizes)
+    {
+        std::string str(size, ' ');
+        for (size_t i = 0; i < size; ++i)
+        {
+            str[i] = 'a' + (i * 7 + size) % 26;
+        }
+        strings.push_back(str);
+    }
+
+    CFileWrap file;
+    CHECK(file.open(path.c_str(), "wb"));
+    for (const std::string &str : strings)
+    {
+        file << str;
+    }
+    file << std::string("end");
+    file.close();
+
+    CHECK(file.open(path.c_str(), "rb"));
+    for (const std::string &str : strings)
+    {
+        std::string read;
+        file >> read;
+        CHECK(read == str);
+    }
+    std::string end;
+    file >> end;
+    CHECK(end == "end");
+    file.close();
+
+    CFileMap map;
+    CHECK(map.open(path.c_str(), "rb"));
+    for (const std::string &str : strings)
+    {
+        std::string read;
+        map >> read;
+        CHECK(read == str);
+    }
+    map >> end;
+    CHECK(end == "end");
+
+    // a length past the end of the file is cut short
+    map.seek(map.getSize() - 2);
+    map >> end;
+    CHECK(end == "d");
+    map.close();
+
+    std::filesystem::remove(path);
+    return TEST_RESULT();
+}
@@ -0,0 +1,195 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// floodFill() against a breadth-first reference on the untouched pixels,
+// for every mix of tolerance, connectivity and alpha-only
+
+namespace
+{
+    struct random_t
+    {
+        uint32_t seed;
+        uint32_t operator()()
+        {
+            seed = seed * 1103515245 + 12345;
+            return seed ^ seed >> 15;
+        }
+    };
+
+    // blobs of a few base colours, jittered so tolerance matters, and
+    // diagonal stripes that only connect through corners
+    void pattern(CFrame &frame, random_t &rnd)
+    {
+        const uint32_t base[] = {0xff204080, 0x80204080, 0xffc0c0c0, 0x00000000};
+        for (int y = 0; y < frame.hei(); ++y)
+        {
+            for (int x = 0; x < frame.len(); ++x)
+            {
+                const int kind = (x / 3 + y / 2 + (rnd() % 5 == 0)) % 4;
+                uint32_t c = (x + y) % 5 == 0 ? 0xff000000 | rnd() % 3 : base[kind];
+                if (rnd() % 3 == 0)
+                {
+                    // +-3 on one channel
+                    const int shift = (rnd() % 4) * 8;
+                    const int v = std::min(std::max((int)((c >> shift) & 0xff) + (int)(rnd() % 7) - 3, 0), 255);
+                    c = (c & ~(0xffu << shift)) | (uint32_t)v << shift;
+                }
+                frame.at(x, y) = c;
+            }
+        }
+    }
+
+    bool matches(uint32_t rgba, uint32_t target, const fillOptions_t &options)
+    {
+        for (int shift = options.alphaOnly ? 24 : 0; shift < 32; shift += 8)
+        {
+            if (abs((int)((rgba >> shift) & 0xff) - (int)((target >> shift) & 0xff)) > options.tolerance)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // what floodFill() should give: the connected pixels that matched
+    // before anything was painted
+    void reference(CFrame &frame, int x, int y, uint32_t target, uint32_t color, const fillOptions_t &options)
+    {
+        const int len = frame.len();
+        const int hei = frame.hei();
+        const uint32_t mask = options.alphaOnly ? 0xff000000 : 0xffffffff;
+        std::vector<bool> inside(len * hei);
+        for (int i = 0; i < len * hei; ++i)
+        {
+            inside[i] = matches(frame.getRGB()[i], target, options);
+        }
+        if (!inside[x + y * len])
+        {
+            return;
+        }
+        std::vector<bool> seen(len * hei);
+        std::deque<std::pair<int, int>> queue{{x, y}};
+        seen[x + y * len] = true;
+        while (!queue.empty())
+        {
+            const auto [px, py] = queue.front();
+            queue.pop_front();
+            uint32_t &c = frame.at(px, py);
+            c = (c & ~mask) | (color & mask);
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    const int nx = px + dx;
+                    const int ny = py + dy;
+                    if ((!dx && !dy) || (dx && dy && !options.diagonal) ||
+                        nx < 0 || ny < 0 || nx >= len || ny >= hei)
+                    {
+                        continue;
+                    }
+                    if (inside[nx + ny * len] && !seen[nx + ny * len])
+                    {
+                        seen[nx + ny * len] = true;
+                        queue.push_back({nx, ny});
+                    }
+                }
+            }
+        }
+    }
+
+    bool same(CFrame &a, CFrame &b)
+    {
+        return a.len() == b.len() && a.hei() == b.hei() &&
+               memcmp(a.getRGB(), b.getRGB(), a.len() * a.hei() * sizeof(uint32_t)) == 0;
+    }
+
+    void testOptions()
+    {
+        const int sizes[][2] = {{1, 1}, {7, 5}, {16, 16}, {33, 9}, {5, 40}};
+        random_t rnd{7};
+        for (const auto &size : sizes)
+        {
+            CFrame src(size[0], size[1]);
+            pattern(src, rnd);
+            for (int tolerance : {0, 2, 5, 255})
+            {
+                for (int flags = 0; flags < 4; ++flags)
+                {
+                    fillOptions_t options;
+                    options.tolerance = tolerance;
+                    options.diagonal = flags & 1;
+                    options.alphaOnly = flags & 2;
+                    for (int n = 0; n < 6; ++n)
+                    {
+                        const int x = rnd() % src.len();
+                        const int y = rnd() % src.hei();
+                        // the start pixel's colour, or another that may not match it
+                        const uint32_t target = n % 3 ? src.at(x, y) : rnd();
+                        const uint32_t color = n == 1 ? target : rnd();
+                        CFrame fill(src);
+                        fill.floodFill(x, y, target, color, options);
+                        CFrame ref(src);
+                        reference(ref, x, y, target, color, options);
+                        CHECK(same(fill, ref));
+                    }
+                }
+            }
+        }
+    }
+
+    // the older entry points are the default options and alpha-only
+    void testWrappers()
+    {
+        random_t rnd{11};
+        CFrame src(24, 18);
+        pattern(src, rnd);
+        fillOptions_t options;
+
+        CFrame fill(src);
+        fill.floodFill(4, 6, src.at(4, 6), 0xff00ff00);
+        CFrame ref(src);
+        reference(ref, 4, 6, src.at(4, 6), 0xff00ff00, options);
+        CHECK(same(fill, ref));
+
+        options.alphaOnly = true;
+        fill = src;
+        fill.floodFillAlpha(10, 3, src.at(10, 3) >> 24, 0x40);
+        ref = src;
+        reference(ref, 10, 3, src.at(10, 3), 0x40000000, options);
+        CHECK(same(fill, ref));
+
+        // outside the frame
+        fill = src;
+        fill.floodFill(-1, 0, 0, 0xffffffff, options);
+        fill.floodFill(0, src.hei(), 0, 0xffffffff, options);
+        CHECK(same(fill, src));
+    }
+}
+
+int main()
+{
+    testOptions();
+    testWrappers();
+    return TEST_RESULT();
+}
@@ -0,0 +1,151 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "FileWrap.h"
+#include "FileMap.h"
+#include <cstring>
+
+// OBL5 write-then-read round trips
+
+namespace
+{
+    uint32_t pixel(int n, int i)
+    {
+        return (n * 2654435761u + i * 40503u) | (i % 5 ? 0xff000000 : 0);
+    }
+
+    void fill(CFrameSet &set, int count)
+    {
+        for (int n = 0; n < count; ++n)
+        {
+            CFrame *frame = new CFrame(8 + n % 13, 5 + n % 7);
+            for (int i = 0; i < frame->len() * frame->hei(); ++i)
+            {
+                frame->getRGB()[i] = pixel(n, i);
+            }
+            set.add(frame);
+        }
+        set.setTag("name", "round trip");
+    }
+
+    bool same(CFrameSet &a, CFrameSet &b)
+    {
+        if (a.getSize() != b.getSize())
+        {
+            return false;
+        }
+        for (int n = 0; n < a.getSize(); ++n)
+        {
+            CFrame *fa = a[n];
+            CFrame *fb = b[n];
+            if (fa->len() != fb->len() || fa->hei() != fb->hei() ||
+                memcmp(fa->getRGB(), fb->getRGB(), fa->len() * fa->hei() * sizeof(uint32_t)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool save(CFrameSet &set, const std::string &path)
+    {
+        CFileWrap file;
+        if (!file.open(path.c_str(), "wb"))
+        {
+            return false;
+        }
+        bool result = set.write(file);
+        file.close();
+        return result;
+    }
+
+    void testRoundTrip(int count)
+    {
+        const std::string path = tempPath("test_obl5.obl");
+        CFrameSet src;
+        fill(src, count);
+        CHECK(save(src, path));
+
+        // header: signature, frame count, format version
+        CFileWrap file;
+        CHECK(file.open(path.c_str(), "rb"));
+        char signature[4];
+        uint32_t size = 0;
+        uint32_t version = 0;
+        file.read(signature, 4);
+        file.read(&size, sizeof(size));
+        file.read(&version, sizeof(version));
+        CHECK(memcmp(signature, "OBL5", 4) == 0);
+        CHECK(size == (uint32_t)count);
+        CHECK(version == CFrameSet::OBL_VERSION);
+
+        // streamed
+        file.seek(0);
+        CFrameSet dest;
+        CHECK(dest.read(file));
+        file.close();
+        CHECK(same(src, dest));
+        CHECK(dest.tag("name") == "round trip");
+
+        // mapped
+        CFileMap map;
+        CHECK(map.open(path.c_str(), "rb"));
+        CFrameSet mapped;
+        CHECK(mapped.read(map));
+        map.close();
+        CHECK(same(src, mapped));
+
+        // frames still packed are written back as they are
+        CHECK(save(mapped, path));
+        CHECK(file.open(path.c_str(), "rb"));
+        CFrameSet again;
+        CHECK(again.read(file));
+        file.close();
+        CHECK(same(src, again));
+
+        std::filesystem::remove(path);
+    }
+
+    // len and hei do not fit the uint16 fields of the frame index
+    void testOversized()
+    {
+        const std::string path = tempPath("test_obl5.obl");
+        for (int i = 0; i < 2; ++i)
+        {
+            CFrameSet set;
+            set.add(new CFrame(8, 8));
+            set.add(i ? new CFrame(1, 65536) : new CFrame(65536, 1));
+            CHECK(!save(set, path));
+            CHECK(strstr(set.getLastError(), "too large") != nullptr);
+        }
+        CFrameSet set;
+        set.add(new CFrame(65535, 1));
+        CHECK(save(set, path));
+        std::filesystem::remove(path);
+    }
+}
+
+int main()
+{
+    testRoundTrip(1);
+    testRoundTrip(40);
+    testOversized();
+    return TEST_RESULT();
+}
@@ -0,0 +1,168 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "FileWrap.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// lazy decoding of OBL5 0x502 sets: frames are inflated on first access
+
+namespace
+{
+    enum
+    {
+        FRAMES = 24,
+        BROKEN = 5,
+        // OBL5 header, then the 0x502 set header and one index entry per frame
+        HEADER_SIZE = 12 + 4,
+        ENTRY_SIZE = 12
+    };
+
+    uint32_t pixel(int n, int i)
+    {
+        return (n * 2654435761u + i * 40503u) | 0xff000000;
+    }
+
+    bool check(CFrame *frame, int n)
+    {
+        if (frame->len() != 16 + n || frame->hei() != 9)
+        {
+            return false;
+        }
+        for (int i = 0; i < frame->len() * frame->hei(); ++i)
+        {
+            if (frame->getRGB()[i] != pixel(n, i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> makeFile()
+    {
+        const std::string path = tempPath("test_obl5_lazy.obl");
+        CFrameSet set;
+        for (int n = 0; n < FRAMES; ++n)
+        {
+            CFrame *frame = new CFrame(16 + n, 9);
+            for (int i = 0; i < frame->len() * frame->hei(); ++i)
+            {
+                frame->getRGB()[i] = pixel(n, i);
+            }
+            set.add(frame);
+        }
+        CFileWrap file;
+        file.open(path.c_str(), "wb");
+        set.write(file);
+        file.close();
+
+        std::vector<uint8_t> data(std::filesystem::file_size(path));
+        file.open(path.c_str(), "rb");
+        file.read(data.data(), data.size());
+        file.close();
+        std::filesystem::remove(path);
+        return data;
+    }
+
+    void load(CFrameSet &set, const std::vector<uint8_t> &data)
+    {
+        const std::string path = tempPath("test_obl5_lazy.obl");
+        CFileWrap file;
+        file.open(path.c_str(), "wb");
+        file.write(data.data(), data.size());
+        file.close();
+        file.open(path.c_str(), "rb");
+        CHECK(set.read(file));
+        file.close();
+        std::filesystem::remove(path);
+    }
+
+    void testConcurrentAccess(const std::vector<uint8_t> &data)
+    {
+        CFrameSet set;
+        load(set, data);
+        std::atomic<int> bad{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&set, &bad, t]() {
+                for (int n = 0; n < FRAMES; ++n)
+                {
+                    const int k = (n + t * 7) % FRAMES;
+                    bad += !check(set[k], k);
+                }
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        CHECK(bad == 0);
+        CHECK(set.materialize());
+    }
+
+    void testBrokenFrame(std::vector<uint8_t> data)
+    {
+        // flip a byte inside the zlib stream of one frame
+        uint32_t offset;
+        memcpy(&offset, &data[HEADER_SIZE + BROKEN * ENTRY_SIZE + 4], sizeof(offset));
+        data[HEADER_SIZE + FRAMES * ENTRY_SIZE + offset + 4] ^= 0xff;
+
+        CFrameSet set;
+        load(set, data);
+        CHECK(check(set[0], 0));
+
+        // the broken frame reads as an empty placeholder, every time
+        CFrame *frame = set[BROKEN];
+        CHECK(frame->len() == 0 && frame->hei() == 0);
+        CHECK(strstr(set.getLastError(), "frame 5") != nullptr);
+        set.setLastError("");
+        CHECK(set[BROKEN]->len() == 0);
+        CHECK(*set.getLastError());
+
+        // operations that need every frame refuse to run
+        CHECK(!set.materialize());
+        CHECK(set.removeAt(0) == nullptr);
+        CFrame extra(1, 1);
+        CHECK(!set.insertAt(0, &extra));
+        unsigned char *png = nullptr;
+        int size = 0;
+        CHECK(!set.toPng(png, size));
+        CHECK(png == nullptr && size == 0);
+        CHECK(set.getSize() == FRAMES);
+
+        // the other frames are still there
+        for (int n = 0; n < FRAMES; ++n)
+        {
+            CHECK(n == BROKEN || check(set[n], n));
+        }
+    }
+}
+
+int main()
+{
+    const std::vector<uint8_t> data = makeFile();
+    testConcurrentAccess(data);
+    testBrokenFrame(data);
+    return TEST_RESULT();
+}
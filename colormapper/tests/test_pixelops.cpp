@@ -0,0 +1,203 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "PixelOps.h"
+#include <vector>
+
+// the SIMD pixel kernels must match plain per-pixel loops at every length
+// and alignment (vector bodies plus scalar remainders)
+
+namespace
+{
+    uint32_t swapRB(uint32_t c)
+    {
+        uint32_t t = c & 0xff00ff00;
+        if (t & 0xff000000)
+        {
+            t += ((c & 0xff) << 16) + ((c & 0xff0000) >> 16);
+        }
+        return t;
+    }
+
+    uint32_t swapGB(uint32_t c)
+    {
+        uint32_t t = c & 0xff0000ff;
+        if (t & 0xff000000)
+        {
+            t += ((c & 0xff00) << 8) + ((c & 0xff0000) >> 8);
+        }
+        return t;
+    }
+
+    struct random_t
+    {
+        uint32_t seed;
+        uint32_t operator()()
+        {
+            seed = seed * 1103515245 + 12345;
+            return seed ^ seed >> 15;
+        }
+    };
+
+    void testKernels(size_t count, size_t shift, random_t &rnd)
+    {
+        // zeroed guard words on both sides of the pixels
+        std::vector<uint32_t> buffer(count + shift + 1);
+        uint32_t *rgb = buffer.data() + shift;
+        for (size_t i = 0; i < count; ++i)
+        {
+            // a quarter transparent, a quarter opaque
+            const uint32_t c = rnd();
+            const int kind = rnd() & 3;
+            rgb[i] = kind == 0 ? c & 0x00ffffff : kind == 1 ? c | 0xff000000 : c;
+        }
+        std::vector<uint32_t> src(rgb, rgb + count);
+
+        bool transparent = false;
+        bool opaque = false;
+        for (uint32_t c : src)
+        {
+            transparent |= !(c >> 24);
+            opaque |= (c >> 24) != 0;
+        }
+        CHECK(pixelAnyTransparent(rgb, count) == transparent);
+        CHECK(pixelAnyOpaque(rgb, count) == opaque);
+
+        int bad = 0;
+        pixelInverse(rgb, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != (src[i] ^ 0x00ffffff);
+        }
+        CHECK(bad == 0);
+
+        std::copy(src.begin(), src.end(), rgb);
+        pixelSwapRB(rgb, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != swapRB(src[i]);
+        }
+        CHECK(bad == 0);
+
+        std::copy(src.begin(), src.end(), rgb);
+        pixelSwapGB(rgb, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != swapGB(src[i]);
+        }
+        CHECK(bad == 0);
+
+        uint8_t lut[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            lut[i] = rnd();
+        }
+        std::copy(src.begin(), src.end(), rgb);
+        pixelMapAlpha(rgb, count, lut);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != ((src[i] & 0x00ffffff) | (uint32_t)lut[src[i] >> 24] << 24);
+        }
+        CHECK(bad == 0);
+
+        // alpha of the key is ignored
+        const uint32_t key = count ? (src[rnd() % count] & 0x00ffffff) | 0xab000000 : 0;
+        std::copy(src.begin(), src.end(), rgb);
+        pixelClearColor(rgb, count, key);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != (((src[i] ^ key) & 0x00ffffff) ? src[i] : 0);
+        }
+        CHECK(bad == 0);
+
+        pixelFill(rgb, count, 0x12345678);
+        for (size_t i = 0; i < count; ++i)
+        {
+            bad += rgb[i] != 0x12345678;
+        }
+        CHECK(bad == 0);
+        // the kernels must stay within rgb[0..count)
+        CHECK(shift == 0 || buffer[shift - 1] == 0);
+        CHECK(buffer.back() == 0);
+    }
+
+    // runs of one alpha, broken up at every offset, for the block paths
+    void testAlphaRuns()
+    {
+        uint8_t lut[256];
+        for (int i = 0; i < 256; ++i)
+        {
+            lut[i] = 255 - i;
+        }
+        for (size_t odd = 0; odd < 40; ++odd)
+        {
+            std::vector<uint32_t> rgb(40);
+            for (size_t i = 0; i < rgb.size(); ++i)
+            {
+                rgb[i] = (i < 20 ? 0xff000000 : 0) | (uint32_t)(i * 0x010203);
+            }
+            rgb[odd] = (rgb[odd] & 0x00ffffff) | 0x80000000;
+            std::vector<uint32_t> src = rgb;
+            pixelMapAlpha(rgb.data(), rgb.size(), lut);
+            int bad = 0;
+            for (size_t i = 0; i < rgb.size(); ++i)
+            {
+                bad += rgb[i] != ((src[i] & 0x00ffffff) | (uint32_t)lut[src[i] >> 24] << 24);
+            }
+            CHECK(bad == 0);
+        }
+    }
+
+    void testAny()
+    {
+        // a single odd pixel at every position of a vector-sized run
+        for (size_t count : {1, 7, 8, 9, 31, 32, 33, 100})
+        {
+            for (size_t pos = 0; pos < count; ++pos)
+            {
+                std::vector<uint32_t> rgb(count, 0xff102030);
+                rgb[pos] = 0x00102030;
+                CHECK(pixelAnyTransparent(rgb.data(), count));
+                CHECK(!pixelAnyOpaque(rgb.data() + pos, 1));
+
+                rgb.assign(count, 0x00102030);
+                rgb[pos] = 0x01000000;
+                CHECK(pixelAnyOpaque(rgb.data(), count));
+                CHECK(!pixelAnyTransparent(rgb.data() + pos, 1));
+            }
+        }
+        CHECK(!pixelAnyTransparent(nullptr, 0));
+        CHECK(!pixelAnyOpaque(nullptr, 0));
+    }
+}
+
+int main()
+{
+    random_t rnd{5};
+    for (size_t count = 0; count < 80; ++count)
+    {
+        for (size_t shift = 0; shift < 4; ++shift)
+        {
+            testKernels(count, shift, rnd);
+        }
+    }
+    testKernels(4099, 1, rnd);
+    testAlphaRuns();
+    testAny();
+    return TEST_RESULT();
+}
@@ -0,0 +1,249 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "PixelPool.h"
+#include <cstring>
+#include <vector>
+
+// CPixelPool alignment, block reuse and the CACHE_FROM_LIVE cache limit of
+// the per-set pools
+
+namespace
+{
+    // the cache counters
+    class probe_t : public CPixelPool
+    {
+    public:
+        probe_t(size_t cacheLimit) : CPixelPool(cacheLimit) {}
+        size_t cached() { return m_cached; }
+        size_t live() { return m_live; }
+        size_t limit() { return cacheLimit(); }
+        using CPixelPool::classSize;
+    };
+
+    void testAlignment()
+    {
+        CPixelPool pool;
+        CHECK(pool.alloc(0) == nullptr);
+        pool.release(nullptr, 0);
+
+        // slab and large blocks; each is filled to check that
+        // none overlap
+        std::vector<std::pair<uint32_t *, int>> blocks;
+        for (int pixels : {1, 3, 64, 65, 100, 129, 1000, 4096, 4097, 70000, 1 << 21})
+        {
+            for (int n = 0; n < 3; ++n)
+            {
+                uint32_t *rgb = pool.alloc(pixels);
+                CHECK((uintptr_t)rgb % CPixelPool::ALIGNMENT == 0);
+                for (int i = 0; i < pixels; ++i)
+                {
+                    rgb[i] = blocks.size();
+                }
+                blocks.push_back({rgb, pixels});
+            }
+        }
+        for (size_t b = 0; b < blocks.size(); ++b)
+        {
+            bool intact = true;
+            for (int i = 0; i < blocks[b].second; ++i)
+            {
+                intact &= blocks[b].first[i] == b;
+            }
+            CHECK(intact);
+            pool.release(blocks[b].first, blocks[b].second);
+        }
+
+        // size classes have at most 25% slack past 512 bytes
+        for (size_t bytes = 1; bytes < (1 << 22); bytes = bytes * 5 / 4 + 1)
+        {
+            int index;
+            const size_t size = probe_t::classSize(bytes, index);
+            CHECK(size >= bytes);
+            CHECK(size <= std::max(bytes + bytes / 4, (size_t)512));
+            CHECK(size % CPixelPool::ALIGNMENT == 0);
+        }
+    }
+
+    void testReuse()
+    {
+        CPixelPool pool;
+        for (int pixels : {16, 1000, 100000})
+        {
+            uint32_t *a = pool.alloc(pixels);
+            uint32_t *b = pool.alloc(pixels);
+            CHECK(a != b);
+            pool.release(a, pixels);
+            pool.release(b, pixels);
+            // last in, first out
+            CHECK(pool.alloc(pixels) == b);
+            CHECK(pool.alloc(pixels) == a);
+            // within the same size class
+            pool.release(a, pixels);
+            CHECK(pool.alloc(pixels - 1) == a);
+            pool.release(a, pixels - 1);
+            pool.release(b, pixels);
+        }
+
+        // released slab blocks are reused before the slab grows
+        std::vector<uint32_t *> blocks;
+        for (int n = 0; n < 100; ++n)
+        {
+            blocks.push_back(pool.alloc(64));
+        }
+        for (int n = 0; n < 100; n += 2)
+        {
+            pool.release(blocks[n], 64);
+        }
+        for (int n = 98; n >= 0; n -= 2)
+        {
+            CHECK(pool.alloc(64) == blocks[n]);
+        }
+        for (uint32_t *rgb : blocks)
+        {
+            pool.release(rgb, 64);
+        }
+    }
+
+    // each set's pool caches a share of its own live pixels
+    void testCacheFromLive()
+    {
+        enum : size_t
+        {
+            MB = 1024 * 1024,
+            COUNT = 32
+        };
+        auto a = std::make_shared<probe_t>(CPixelPool::CACHE_FROM_LIVE);
+        auto b = std::make_shared<probe_t>(CPixelPool::CACHE_FROM_LIVE);
+        std::vector<CFrame *> setA;
+        std::vector<CFrame *> setB;
+        for (size_t n = 0; n < COUNT; ++n)
+        {
+            setA.push_back(new CFrame(512, 512, a));
+            setB.push_back(new CFrame(512, 512, b));
+        }
+        CHECK(a->live() == COUNT * MB);
+        CHECK(a->limit() == COUNT * MB / CPixelPool::LIVE_SHARE);
+
+        // a quarter of what is still live stays cached
+        for (size_t n = 0; n < 8; ++n)
+        {
+            delete setA.back();
+            setA.pop_back();
+            CHECK(a->cached() <= a->limit());
+        }
+        CHECK(a->live() == 24 * MB);
+        CHECK(a->cached() == 6 * MB);
+        CHECK(b->cached() == 0);
+
+        // with nothing live, at most a slab's worth
+        for (CFrame *frame : setA)
+        {
+            delete frame;
+        }
+        CHECK(a->live() == 0);
+        CHECK(a->limit() == CPixelPool::SLAB_SIZE);
+        CHECK(a->cached() == 0);
+
+        // the other set keeps its own share
+        for (size_t n = 0; n < 4; ++n)
+        {
+            delete setB.back();
+            setB.pop_back();
+        }
+        CHECK(b->cached() == 4 * MB);
+
+        // a fixed limit caches everything under it
+        probe_t fixed(CPixelPool::DEFAULT_CACHE_LIMIT);
+        std::vector<uint32_t *> blocks;
+        for (size_t n = 0; n < COUNT; ++n)
+        {
+            blocks.push_back(fixed.alloc(MB / 4));
+        }
+        for (uint32_t *rgb : blocks)
+        {
+            fixed.release(rgb, MB / 4);
+        }
+        CHECK(fixed.cached() == COUNT * MB);
+
+        // small blocks: the empty slabs are freed, bar the one being carved
+        std::vector<CFrame *> small;
+        for (int n = 0; n < 2000; ++n)
+        {
+            small.push_back(new CFrame(16, 16, b));
+        }
+        for (CFrame *frame : small)
+        {
+            delete frame;
+        }
+        CHECK(b->cached() <= b->limit());
+
+        for (CFrame *frame : setB)
+        {
+            delete frame;
+        }
+    }
+
+    // frames hold on to the pool they were made with
+    void testAcrossSets()
+    {
+        CFrameSet *a = new CFrameSet;
+        CFrameSet b;
+        CHECK(a->pool() != b.pool());
+        CHECK(a->pool() != CPixelPool::global());
+        a->add(new CFrame(40, 30, a->pool()));
+        a->add(new CFrame(40, 30, a->pool()));
+        for (int i = 0; i < 40 * 30; ++i)
+        {
+            (*a)[0]->getRGB()[i] = 0xff000000 | i;
+        }
+
+        CFrame *frame = a->removeAt(0);
+        b.add(frame);
+        std::weak_ptr<CPixelPool> pool = a->pool();
+        delete a;
+        CHECK(!pool.expired());
+        CHECK(frame->pool() == pool.lock());
+
+        bool intact = true;
+        for (int i = 0; i < 40 * 30; ++i)
+        {
+            intact &= frame->getRGB()[i] == (0xff000000 | i);
+        }
+        CHECK(intact);
+
+        // growing reallocates from the same pool
+        frame->enlarge();
+        CHECK(frame->pool() == pool.lock());
+        CHECK(frame->at(79, 59) == (0xff000000 | (40 * 30 - 1)));
+
+        b.forget();
+        CHECK(pool.expired());
+    }
+}
+
+int main()
+{
+    testAlignment();
+    testReuse();
+    testCacheFromLive();
+    testAcrossSets();
+    return TEST_RESULT();
+}
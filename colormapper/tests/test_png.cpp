@@ -0,0 +1,250 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "FileMap.h"
+#include "FileWrap.h"
+#include "PngFilter.h"
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+// PNG decoding with the image data spread over IDAT chunks of any size
+
+namespace
+{
+    enum
+    {
+        WIDTH = 37,
+        HEIGHT = 23,
+        WHOLE = 0 // one IDAT chunk for the whole stream
+    };
+
+    struct image_t
+    {
+        uint8_t colorType;
+        int channels;
+        std::vector<uint8_t> pixels;  // unfiltered scanlines
+        std::vector<uint32_t> expect; // decoded rgba
+        std::vector<uint8_t> plte;
+        std::vector<uint8_t> trns;
+    };
+
+    void put32(std::vector<uint8_t> &out, uint32_t v)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            out.push_back(v >> shift);
+        }
+    }
+
+    void putChunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size)
+    {
+        put32(out, size);
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        put32(out, crc32(0, &out[start], out.size() - start));
+    }
+
+    std::vector<uint8_t> makePng(const image_t &image, size_t idatSize)
+    {
+        // filter each row with a different type so every unfilter runs
+        const int rowBytes = WIDTH * image.channels;
+        std::vector<uint8_t> filtered;
+        std::vector<uint8_t> zero(rowBytes);
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            const uint8_t filter = y % PNG_FILTER_COUNT;
+            const uint8_t *row = &image.pixels[y * rowBytes];
+            const uint8_t *prior = y ? row - rowBytes : zero.data();
+            filtered.push_back(filter);
+            filtered.resize(filtered.size() + rowBytes);
+            pngFilterRow(filter, &filtered[filtered.size() - rowBytes], row, prior, rowBytes, image.channels);
+        }
+        uLongf packedSize = compressBound(filtered.size());
+        std::vector<uint8_t> packed(packedSize);
+        compress2(packed.data(), &packedSize, filtered.data(), filtered.size(), 9);
+        packed.resize(packedSize);
+
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<uint8_t> png(signature, signature + sizeof(signature));
+        std::vector<uint8_t> ihdr;
+        put32(ihdr, WIDTH);
+        put32(ihdr, HEIGHT);
+        ihdr.insert(ihdr.end(), {8, image.colorType, 0, 0, 0});
+        putChunk(png, "IHDR", ihdr.data(), ihdr.size());
+        if (!image.plte.empty())
+        {
+            putChunk(png, "PLTE", image.plte.data(), image.plte.size());
+        }
+        if (!image.trns.empty())
+        {
+            putChunk(png, "tRNS", image.trns.data(), image.trns.size());
+        }
+        const size_t step = idatSize == WHOLE ? packed.size() : idatSize;
+        for (size_t i = 0; i < packed.size(); i += step)
+        {
+            putChunk(png, "IDAT", &packed[i], std::min(step, packed.size() - i));
+        }
+        putChunk(png, "IEND", nullptr, 0);
+        return png;
+    }
+
+    image_t makeImage(uint8_t colorType)
+    {
+        image_t image;
+        image.colorType = colorType;
+        image.channels = colorType == 6 ? 4 : colorType == 2 ? 3 : 1;
+        uint32_t seed = colorType + 1;
+        for (int i = 0; i < WIDTH * HEIGHT; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            uint8_t c[4] = {uint8_t(seed >> 24), uint8_t(seed >> 16), uint8_t(seed >> 8), uint8_t(i)};
+            switch (colorType)
+            {
+            case 0: // grey
+                image.pixels.push_back(c[0]);
+                image.expect.push_back(c[0] * 0x010101u | 0xff000000);
+                break;
+            case 2: // rgb
+                image.pixels.insert(image.pixels.end(), c, c + 3);
+                image.expect.push_back(c[0] | c[1] << 8 | c[2] << 16 | 0xff000000);
+                break;
+            case 3: // palette: index i & 15
+                image.pixels.push_back(i & 15);
+                break;
+            case 6: // rgba
+                image.pixels.insert(image.pixels.end(), c, c + 4);
+                image.expect.push_back(c[0] | c[1] << 8 | c[2] << 16 | uint32_t(c[3]) << 24);
+                break;
+            }
+        }
+        if (colorType == 3)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                image.plte.insert(image.plte.end(), {uint8_t(i * 16), uint8_t(255 - i), uint8_t(i * 3)});
+                image.trns.push_back(i * 17);
+            }
+            for (int i = 0; i < WIDTH * HEIGHT; ++i)
+            {
+                const int n = i & 15;
+                image.expect.push_back(n * 16 | (255 - n) << 8 | n * 3 << 16 | uint32_t(n * 17) << 24);
+            }
+        }
+        return image;
+    }
+
+    bool decode(const std::vector<uint8_t> &png, CFrameSet &set, bool mapped)
+    {
+        const std::string path = tempPath("test_png.png");
+        CFileWrap file;
+        file.open(path.c_str(), "wb");
+        file.write(png.data(), png.size());
+        file.close();
+
+        bool result;
+        if (mapped)
+        {
+            CFileMap map;
+            map.open(path.c_str(), "rb");
+            result = set.extract(map);
+            map.close();
+        }
+        else
+        {
+            file.open(path.c_str(), "rb");
+            result = set.extract(file);
+            file.close();
+        }
+        std::filesystem::remove(path);
+        return result;
+    }
+
+    bool matches(CFrameSet &set, const image_t &image)
+    {
+        // frames are padded to multiples of 8, with the rows at the bottom
+        const int offsetY = (8 - (HEIGHT & 7)) & 7;
+        if (set.getSize() != 1 || set[0]->len() != ((WIDTH + 7) & ~7) || set[0]->hei() != HEIGHT + offsetY)
+        {
+            return false;
+        }
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                // fully transparent pixels may come back with their colour cleared
+                const uint32_t got = set[0]->at(x, y + offsetY);
+                const uint32_t want = image.expect[y * WIDTH + x];
+                if (got != want && (want >> 24 || got >> 24))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void testSplit(uint8_t colorType)
+    {
+        const image_t image = makeImage(colorType);
+        for (size_t idatSize : {(size_t)WHOLE, (size_t)1, (size_t)7, (size_t)1000})
+        {
+            const std::vector<uint8_t> png = makePng(image, idatSize);
+            for (bool mapped : {false, true})
+            {
+                CFrameSet set;
+                CHECK(decode(png, set, mapped));
+                CHECK(matches(set, image));
+            }
+        }
+    }
+
+    void testDamaged()
+    {
+        const std::vector<uint8_t> png = makePng(makeImage(6), 100);
+
+        // a flipped payload byte in an IDAT chunk fails its CRC
+        std::vector<uint8_t> bad = png;
+        bad[bad.size() / 2] ^= 0x40;
+        CFrameSet set;
+        CHECK(!decode(bad, set, false));
+        CHECK(*set.getLastError());
+
+        // the stream ends before the image does
+        bad.assign(png.begin(), png.begin() + png.size() / 2);
+        const char *iend = "IEND";
+        put32(bad, 0);
+        bad.insert(bad.end(), iend, iend + 4);
+        put32(bad, crc32(0, (const Bytef *)iend, 4));
+        CFrameSet truncated;
+        CHECK(!decode(bad, truncated, true));
+    }
+}
+
+int main()
+{
+    for (uint8_t colorType : {0, 2, 3, 6})
+    {
+        testSplit(colorType);
+    }
+    testDamaged();
+    return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "PngFilter.h"
+#include <cstring>
+#include <vector>
+
+// the dispatched filter kernels must match the scalar reference and
+// every filter must invert exactly
+
+namespace
+{
+    std::vector<uint8_t> makeRow(int size, uint32_t seed)
+    {
+        std::vector<uint8_t> row(size);
+        for (int i = 0; i < size; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            row[i] = seed >> 24;
+        }
+        return row;
+    }
+
+    void testRow(int rowBytes, int bpp, bool firstRow)
+    {
+        const std::vector<uint8_t> row = makeRow(rowBytes, rowBytes * 31 + bpp);
+        const std::vector<uint8_t> prior = firstRow ? std::vector<uint8_t>(rowBytes) : makeRow(rowBytes, bpp);
+        std::vector<uint8_t> out(rowBytes);
+        std::vector<uint8_t> ref(rowBytes);
+
+        for (uint8_t filter = 0; filter < PNG_FILTER_COUNT; ++filter)
+        {
+            const int sum = pngFilterRow(filter, out.data(), row.data(), prior.data(), rowBytes, bpp);
+            const int refSum = pngFilterRowScalar(filter, ref.data(), row.data(), prior.data(), rowBytes, bpp);
+            CHECK(sum == refSum);
+            CHECK(out == ref);
+
+            std::vector<uint8_t> back = out;
+            CHECK(pngUnfilterRow(filter, back.data(), prior.data(), rowBytes, bpp));
+            CHECK(back == row);
+            CHECK(pngUnfilterRowScalar(filter, ref.data(), prior.data(), rowBytes, bpp));
+            CHECK(ref == row);
+        }
+
+        for (int mode : {PNG_FILTER_ADAPTIVE, PNG_FILTER_FAST})
+        {
+            const uint8_t filter = pngSelectFilter(mode, out.data(), row.data(), prior.data(), rowBytes, bpp);
+            CHECK(filter < PNG_FILTER_COUNT);
+            CHECK(mode != PNG_FILTER_FAST || filter <= PNG_FILTER_UP);
+            CHECK(pngUnfilterRow(filter, out.data(), prior.data(), rowBytes, bpp));
+            CHECK(out == row);
+        }
+    }
+}
+
+int main()
+{
+    for (int bpp : {1, 2, 3, 4, 6, 8})
+    {
+        for (int pixels : {1, 2, 5, 16, 33, 100, 257})
+        {
+            testRow(pixels * bpp, bpp, false);
+            testRow(pixels * bpp, bpp, true);
+        }
+    }
+
+    uint8_t row[4] = {};
+    uint8_t prior[4] = {};
+    CHECK(!pngUnfilterRow(PNG_FILTER_COUNT, row, prior, 4, 4));
+    return TEST_RESULT();
+}
@@ -0,0 +1,306 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "FrameSet.h"
+#include "FileMap.h"
+#include "FileWrap.h"
+#include "PngFilter.h"
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+// PngSuite conformance: every file is decoded and compared with the
+// reference decoding in pngsuite/reference.inc, then re-encoded with Adam7
+// interlacing (same colour type, bit depth and ancillary chunks) and
+// compared again, so every legal colour type / bit depth is also checked
+// interlaced
+
+namespace
+{
+    struct reference_t
+    {
+        const char *name;
+        int width;
+        int height;
+        uint32_t crc;
+    };
+
+    const reference_t g_reference[] = {
+#include "pngsuite/reference.inc"
+    };
+
+    struct chunk_t
+    {
+        std::string type;
+        std::vector<uint8_t> data;
+    };
+
+    // Adam7 pass origin and spacing
+    const struct
+    {
+        int x0;
+        int y0;
+        int dx;
+        int dy;
+    } g_passes[] = {
+        {0, 0, 8, 8},
+        {4, 0, 8, 8},
+        {0, 4, 4, 8},
+        {2, 0, 4, 4},
+        {0, 2, 2, 4},
+        {1, 0, 2, 2},
+        {0, 1, 1, 2},
+    };
+
+    uint32_t get32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    }
+
+    void put32(std::vector<uint8_t> &out, uint32_t v)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            out.push_back(v >> shift);
+        }
+    }
+
+    void putChunk(std::vector<uint8_t> &out, const chunk_t &chunk)
+    {
+        put32(out, chunk.data.size());
+        const size_t start = out.size();
+        out.insert(out.end(), chunk.type.begin(), chunk.type.end());
+        out.insert(out.end(), chunk.data.begin(), chunk.data.end());
+        put32(out, crc32(0, &out[start], out.size() - start));
+    }
+
+    std::vector<uint8_t> readFile(const std::string &path)
+    {
+        std::vector<uint8_t> data;
+        CFileWrap file;
+        if (file.open(path.c_str(), "rb"))
+        {
+            data.resize(file.getSize());
+            file.read(data.data(), data.size());
+            file.close();
+        }
+        return data;
+    }
+
+    std::vector<chunk_t> parseChunks(const std::vector<uint8_t> &png)
+    {
+        std::vector<chunk_t> chunks;
+        for (size_t pos = 8; pos + 12 <= png.size();)
+        {
+            const uint32_t size = get32(&png[pos]);
+            chunk_t chunk;
+            chunk.type.assign((const char *)&png[pos + 4], 4);
+            chunk.data.assign(png.begin() + pos + 8, png.begin() + pos + 8 + size);
+            chunks.push_back(chunk);
+            pos += size + 12;
+        }
+        return chunks;
+    }
+
+    // value of pixel x of a scanline, bits per pixel wide
+    uint64_t getPixel(const uint8_t *row, int x, int bits)
+    {
+        if (bits < 8)
+        {
+            const int bit = x * bits;
+            return (row[bit / 8] >> (8 - bits - bit % 8)) & ((1 << bits) - 1);
+        }
+        uint64_t v = 0;
+        memcpy(&v, row + x * bits / 8, bits / 8);
+        return v;
+    }
+
+    void setPixel(uint8_t *row, int x, int bits, uint64_t v)
+    {
+        if (bits < 8)
+        {
+            const int bit = x * bits;
+            row[bit / 8] |= v << (8 - bits - bit % 8);
+            return;
+        }
+        memcpy(row + x * bits / 8, &v, bits / 8);
+    }
+
+    // the same image with Adam7 interlacing
+    std::vector<uint8_t> interlace(const std::vector<uint8_t> &png)
+    {
+        const std::vector<chunk_t> chunks = parseChunks(png);
+        const std::vector<uint8_t> &ihdr = chunks[0].data;
+        const int width = get32(&ihdr[0]);
+        const int height = get32(&ihdr[4]);
+        const int depth = ihdr[8];
+        const int colorType = ihdr[9];
+        const int channels = colorType == 2 ? 3 : colorType == 4 ? 2 : colorType == 6 ? 4 : 1;
+        const int bits = channels * depth;
+        const int rowBytes = (width * bits + 7) / 8;
+        const int bpp = std::max(1, bits / 8);
+
+        // inflate and unfilter the progressive image
+        std::vector<uint8_t> packed;
+        for (const chunk_t &chunk : chunks)
+        {
+            if (chunk.type == "IDAT")
+            {
+                packed.insert(packed.end(), chunk.data.begin(), chunk.data.end());
+            }
+        }
+        std::vector<uint8_t> raw((rowBytes + 1) * height);
+        uLongf rawSize = raw.size();
+        CHECK(uncompress(raw.data(), &rawSize, packed.data(), packed.size()) == Z_OK);
+        std::vector<uint8_t> zero(rowBytes);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t *row = &raw[y * (rowBytes + 1)];
+            const uint8_t *prior = y ? row - rowBytes : zero.data();
+            CHECK(pngUnfilterRowScalar(row[0], row + 1, prior, rowBytes, bpp));
+        }
+
+        // passes of filter type 0 scanlines; empty passes have no rows
+        std::vector<uint8_t> filtered;
+        for (const auto &pass : g_passes)
+        {
+            const int passWidth = width > pass.x0 ? (width - pass.x0 + pass.dx - 1) / pass.dx : 0;
+            if (!passWidth)
+            {
+                continue;
+            }
+            const int passBytes = (passWidth * bits + 7) / 8;
+            for (int y = pass.y0; y < height; y += pass.dy)
+            {
+                const uint8_t *src = &raw[y * (rowBytes + 1) + 1];
+                filtered.push_back(PNG_FILTER_NONE);
+                filtered.resize(filtered.size() + passBytes);
+                uint8_t *dest = &filtered[filtered.size() - passBytes];
+                for (int i = 0; i < passWidth; ++i)
+                {
+                    setPixel(dest, i, bits, getPixel(src, pass.x0 + i * pass.dx, bits));
+                }
+            }
+        }
+        uLongf size = compressBound(filtered.size());
+        chunk_t idat{"IDAT", std::vector<uint8_t>(size)};
+        CHECK(compress2(idat.data.data(), &size, filtered.data(), filtered.size(), 9) == Z_OK);
+        idat.data.resize(size);
+
+        // ancillary chunks are kept in place
+        std::vector<uint8_t> out(png.begin(), png.begin() + 8);
+        bool written = false;
+        for (chunk_t chunk : chunks)
+        {
+            if (chunk.type == "IHDR")
+            {
+                chunk.data[12] = 1;
+            }
+            else if (chunk.type == "IDAT")
+            {
+                if (!written)
+                {
+                    putChunk(out, idat);
+                    written = true;
+                }
+                continue;
+            }
+            putChunk(out, chunk);
+        }
+        return out;
+    }
+
+    // crc32 of the image area of the frame: frames are padded to
+    // multiples of 8, with the rows at the bottom
+    bool matches(CFrameSet &set, const reference_t &ref)
+    {
+        const int offsetY = (8 - (ref.height & 7)) & 7;
+        if (set.getSize() != 1 || set[0]->len() != ((ref.width + 7) & ~7) || set[0]->hei() != ref.height + offsetY)
+        {
+            return false;
+        }
+        uLong crc = crc32(0, Z_NULL, 0);
+        for (int y = 0; y < ref.height; ++y)
+        {
+            crc = crc32(crc, (const Bytef *)&set[0]->at(0, y + offsetY), ref.width * sizeof(uint32_t));
+        }
+        return crc == ref.crc;
+    }
+
+    bool decode(const std::vector<uint8_t> &png, CFrameSet &set)
+    {
+        const std::string path = tempPath("test_pngsuite.png");
+        CFileWrap file;
+        file.open(path.c_str(), "wb");
+        file.write(png.data(), png.size());
+        file.close();
+        file.open(path.c_str(), "rb");
+        const bool result = set.extract(file);
+        file.close();
+        std::filesystem::remove(path);
+        return result;
+    }
+}
+
+int main()
+{
+    std::set<std::pair<int, int>> formats;
+    for (const reference_t &ref : g_reference)
+    {
+        const std::string path = std::string(PNGSUITE_DIR "/") + ref.name;
+        const std::vector<uint8_t> png = readFile(path);
+        CHECK(png.size() > 33);
+        if (png.size() <= 33)
+        {
+            continue;
+        }
+        formats.insert({png[25], png[24]});
+
+        // as shipped, mapped
+        CFileMap map;
+        CFrameSet set;
+        CHECK(map.open(path.c_str(), "rb"));
+        CHECK(set.extract(map));
+        map.close();
+        if (!matches(set, ref))
+        {
+            fprintf(stderr, "%s: decoded image differs\n", ref.name);
+            CHECK(false);
+        }
+
+        // Adam7
+        if (!png[28])
+        {
+            CFrameSet interlaced;
+            CHECK(decode(interlace(png), interlaced));
+            if (!matches(interlaced, ref))
+            {
+                fprintf(stderr, "%s: interlaced image differs\n", ref.name);
+                CHECK(false);
+            }
+        }
+    }
+
+    // the 15 legal colour type / bit depth combinations
+    CHECK(formats.size() == 15);
+    return TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "Resampler.h"
+#include <cstring>
+#include <vector>
+
+// the resampler's filters: identity at the same size, NEAREST against the
+// old pixel-doubling enlarge() / shrink(), flat areas staying flat, no
+// colour from transparent pixels, and scale2x on known patterns
+
+namespace
+{
+    const int SIZES[][2] = {{1, 1}, {3, 2}, {17, 9}, {64, 33}};
+
+    void randomize(CFrame &frame, bool visible)
+    {
+        uint32_t seed = frame.len() * 131 + frame.hei();
+        for (int i = 0; i < frame.len() * frame.hei(); ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            const uint32_t c = seed ^ seed >> 13;
+            // visible: alpha 1..255, as alpha 0 drops the colour
+            frame.getRGB()[i] = visible && !(c >> 24) ? c | 0x01000000 : c;
+        }
+    }
+
+    bool same(CFrame &a, CFrame &b)
+    {
+        return a.len() == b.len() && a.hei() == b.hei() &&
+               memcmp(a.getRGB(), b.getRGB(), a.len() * a.hei() * sizeof(uint32_t)) == 0;
+    }
+
+    void testIdentity()
+    {
+        for (const auto &size : SIZES)
+        {
+            CFrame src(size[0], size[1]);
+            randomize(src, true);
+            for (int filter = 0; filter < RESAMPLE_FILTER_COUNT; ++filter)
+            {
+                CFrame dest(src);
+                dest.scale(src.len(), src.hei(), filter);
+                CHECK(same(dest, src));
+            }
+        }
+    }
+
+    // enlarge() and shrink() as they were before the resampler
+    void testNearest()
+    {
+        for (const auto &size : SIZES)
+        {
+            CFrame src(size[0], size[1]);
+            randomize(src, false);
+
+            CFrame big(src);
+            big.enlarge();
+            CFrame bigRef(src.len() * 2, src.hei() * 2);
+            for (int y = 0; y < src.hei(); ++y)
+            {
+                for (int x = 0; x < src.len(); ++x)
+                {
+                    const uint32_t c = src.at(x, y);
+                    bigRef.at(x * 2, y * 2) = c;
+                    bigRef.at(x * 2 + 1, y * 2) = c;
+                    bigRef.at(x * 2, y * 2 + 1) = c;
+                    bigRef.at(x * 2 + 1, y * 2 + 1) = c;
+                }
+            }
+            CHECK(same(big, bigRef));
+
+            if (src.len() < 2 || src.hei() < 2)
+            {
+                continue;
+            }
+            CFrame small(src);
+            small.shrink();
+            CFrame smallRef(src.len() / 2, src.hei() / 2);
+            for (int y = 0; y < src.hei() / 2; ++y)
+            {
+                for (int x = 0; x < src.len() / 2; ++x)
+                {
+                    smallRef.at(x, y) = src.at(x * 2, y * 2);
+                }
+            }
+            CHECK(same(small, smallRef));
+        }
+    }
+
+    // the weights of every output pixel add up to one
+    void testConstant()
+    {
+        const uint32_t color = 0xff3c7a19;
+        const int targets[][2] = {{1, 1}, {5, 3}, {13, 7}, {40, 21}, {97, 2}};
+        CFrame src(13, 7);
+        for (int i = 0; i < src.len() * src.hei(); ++i)
+        {
+            src.getRGB()[i] = color;
+        }
+        for (int filter : {RESAMPLE_BOX, RESAMPLE_BILINEAR, RESAMPLE_LANCZOS3})
+        {
+            for (const auto &target : targets)
+            {
+                CFrame dest(src);
+                dest.scale(target[0], target[1], filter);
+                bool flat = dest.len() == target[0] && dest.hei() == target[1];
+                for (int i = 0; flat && i < dest.len() * dest.hei(); ++i)
+                {
+                    flat = dest.getRGB()[i] == color;
+                }
+                CHECK(flat);
+            }
+        }
+    }
+
+    // colours are filtered premultiplied, so the rgb of transparent pixels
+    // never shows up around the opaque ones
+    void testNoBleed()
+    {
+        const uint32_t color = 0xff2080ff;
+        const int targets[][2] = {{5, 4}, {11, 7}, {31, 23}, {48, 36}};
+        CFrame src(16, 12);
+        for (int y = 0; y < src.hei(); ++y)
+        {
+            for (int x = 0; x < src.len(); ++x)
+            {
+                // a diamond on transparent green
+                const bool inside = abs(x * 2 - 15) + abs(y * 2 - 11) < 12;
+                src.at(x, y) = inside ? color : 0x0000ff00;
+            }
+        }
+        for (int filter : {RESAMPLE_BOX, RESAMPLE_BILINEAR, RESAMPLE_LANCZOS3})
+        {
+            for (const auto &target : targets)
+            {
+                CFrame dest(src);
+                dest.scale(target[0], target[1], filter);
+                bool clean = true;
+                int partial = 0;
+                for (int i = 0; i < dest.len() * dest.hei(); ++i)
+                {
+                    const uint32_t c = dest.getRGB()[i];
+                    clean &= c >> 24 ? (c & 0xffffff) == (color & 0xffffff) : c == 0;
+                    partial += c >> 24 && c >> 24 != 0xff;
+                }
+                CHECK(clean);
+                // the edges were actually blended
+                CHECK(partial > 0 || filter == RESAMPLE_BOX);
+            }
+        }
+    }
+
+    // '#' and '.' pixel art, one row per string
+    CFrame fromArt(const std::vector<const char *> &art)
+    {
+        CFrame frame(strlen(art[0]), art.size());
+        for (int y = 0; y < frame.hei(); ++y)
+        {
+            for (int x = 0; x < frame.len(); ++x)
+            {
+                frame.at(x, y) = art[y][x] == '#' ? 0xff000000 : 0xffffffff;
+            }
+        }
+        return frame;
+    }
+
+    void testScale2x()
+    {
+        // a staircase edge comes out as a smooth diagonal
+        CFrame stairs = fromArt({"#...",
+                                 "##..",
+                                 "###.",
+                                 "####"});
+        stairs.scale(8, 8, RESAMPLE_SCALE2X);
+        CFrame smooth = fromArt({"##......",
+                                 "###.....",
+                                 "###.....",
+                                 "#####...",
+                                 "#####...",
+                                 "#######.",
+                                 "########",
+                                 "########"});
+        CHECK(same(stairs, smooth));
+
+        // a one pixel diagonal line is thickened along its length
+        CFrame line = fromArt({"#...",
+                               ".#..",
+                               "..#.",
+                               "...#"});
+        CFrame scaled(line);
+        line.scale(8, 8, RESAMPLE_SCALE2X);
+        CFrame thick = fromArt({"##......",
+                                "#.#.....",
+                                ".###....",
+                                "..###...",
+                                "...###..",
+                                "....###.",
+                                ".....#.#",
+                                "......##"});
+        CHECK(same(line, thick));
+
+        // doublings while they fit, then nearest for the rest
+        scaled.scale(12, 10, RESAMPLE_SCALE2X);
+        CFrame nearest(thick);
+        nearest.scale(12, 10, RESAMPLE_NEAREST);
+        CHECK(same(scaled, nearest));
+    }
+}
+
+int main()
+{
+    testIdentity();
+    testNearest();
+    testConstant();
+    testNoBleed();
+    testScale2x();
+    return TEST_RESULT();
+}
@@ -0,0 +1,161 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include <cstring>
+#include <functional>
+
+// rotate, flips and shifts against per-pixel definitions, including sizes
+// that straddle the cache blocks
+
+namespace
+{
+    typedef std::function<uint32_t(CFrame &src, int x, int y)> source_t;
+
+    void randomize(CFrame &frame)
+    {
+        uint32_t seed = frame.len() * 131 + frame.hei();
+        for (int i = 0; i < frame.len() * frame.hei(); ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            frame.getRGB()[i] = seed ^ seed >> 13;
+        }
+    }
+
+    // every pixel of dest is src's pixel given by fn
+    bool matches(CFrame &dest, CFrame &src, int len, int hei, const source_t &fn)
+    {
+        if (dest.len() != len || dest.hei() != hei)
+        {
+            return false;
+        }
+        for (int y = 0; y < hei; ++y)
+        {
+            for (int x = 0; x < len; ++x)
+            {
+                if (dest.at(x, y) != fn(src, x, y))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void testRotate(CFrame &src)
+    {
+        const int len = src.len();
+        const int hei = src.hei();
+        const source_t cw = [len, hei](CFrame &s, int x, int y) { return s.at(y, hei - 1 - x); };
+        const source_t half = [len, hei](CFrame &s, int x, int y) { return s.at(len - 1 - x, hei - 1 - y); };
+        const source_t ccw = [len, hei](CFrame &s, int x, int y) { return s.at(len - 1 - y, x); };
+        const source_t same = [](CFrame &s, int x, int y) { return s.at(x, y); };
+
+        const struct
+        {
+            int degrees;
+            bool swapped;
+            const source_t &fn;
+        } cases[] = {
+            {90, true, cw},
+            {180, false, half},
+            {270, true, ccw},
+            {-90, true, ccw},
+            {450, true, cw},
+            {0, false, same},
+            {45, false, same}, // not a quarter turn: unchanged
+        };
+        for (const auto &c : cases)
+        {
+            CFrame frame(src);
+            frame.rotate(c.degrees);
+            CHECK(matches(frame, src, c.swapped ? hei : len, c.swapped ? len : hei, c.fn));
+        }
+        CFrame frame(src);
+        frame.rotate();
+        CHECK(matches(frame, src, hei, len, cw));
+    }
+
+    void testFlip(CFrame &src)
+    {
+        const int len = src.len();
+        const int hei = src.hei();
+        CFrame frame(src);
+        frame.flipH();
+        CHECK(matches(frame, src, len, hei, [len](CFrame &s, int x, int y) { return s.at(len - 1 - x, y); }));
+        frame = src;
+        frame.flipV();
+        CHECK(matches(frame, src, len, hei, [hei](CFrame &s, int x, int y) { return s.at(x, hei - 1 - y); }));
+    }
+
+    void testShift(CFrame &src, bool wrap)
+    {
+        const int len = src.len();
+        const int hei = src.hei();
+        // pixel (x, y) of src, or what shifts in at the edge
+        const auto pick = [wrap, len, hei](CFrame &s, int x, int y) -> uint32_t {
+            if (x < 0 || x >= len || y < 0 || y >= hei)
+            {
+                if (!wrap)
+                {
+                    return 0;
+                }
+                x = (x + len) % len;
+                y = (y + hei) % hei;
+            }
+            return s.at(x, y);
+        };
+
+        CFrame frame(src);
+        frame.shiftUP(wrap);
+        CHECK(matches(frame, src, len, hei, [&pick](CFrame &s, int x, int y) { return pick(s, x, y + 1); }));
+        frame = src;
+        frame.shiftDOWN(wrap);
+        CHECK(matches(frame, src, len, hei, [&pick](CFrame &s, int x, int y) { return pick(s, x, y - 1); }));
+        frame = src;
+        frame.shiftLEFT(wrap);
+        CHECK(matches(frame, src, len, hei, [&pick](CFrame &s, int x, int y) { return pick(s, x + 1, y); }));
+        frame = src;
+        frame.shiftRIGHT(wrap);
+        CHECK(matches(frame, src, len, hei, [&pick](CFrame &s, int x, int y) { return pick(s, x - 1, y); }));
+    }
+}
+
+int main()
+{
+    const int sizes[][2] = {{1, 1}, {1, 7}, {7, 1}, {3, 3}, {33, 33}, {64, 64}, {65, 65}, {31, 70}, {70, 31}, {100, 37}, {128, 128}, {5, 200}};
+    for (const auto &size : sizes)
+    {
+        CFrame src(size[0], size[1]);
+        randomize(src);
+        testRotate(src);
+        testFlip(src);
+        testShift(src, true);
+        testShift(src, false);
+    }
+
+    // empty frames are left alone
+    CFrame empty;
+    empty.rotate(90);
+    empty.flipH();
+    empty.flipV();
+    empty.shiftUP();
+    empty.shiftLEFT();
+    CHECK(empty.len() == 0 && empty.hei() == 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,208 @@
+/*
+    LGCK Builder Runtime
+    Copyright (C) 1999, 2026  Francois Blanchette
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "check.h"
+#include "Frame.h"
+#include "Undo.h"
+#include <cstring>
+#include <vector>
+
+// CUndo round trips, tile sharing between snapshots and trimming to the
+// memory budget
+
+namespace
+{
+    enum
+    {
+        TILE = 64,
+        TILE_BYTES = TILE * TILE * sizeof(uint32_t)
+    };
+
+    // a copy of the pixels, for comparing states
+    struct state_t
+    {
+        int len;
+        int hei;
+        std::vector<uint32_t> rgb;
+
+        state_t(CFrame &frame)
+            : len(frame.len()), hei(frame.hei()),
+              rgb(frame.getRGB(), frame.getRGB() + frame.len() * frame.hei()) {}
+
+        bool operator==(CFrame &frame) const
+        {
+            return len == frame.len() && hei == frame.hei() &&
+                   memcmp(rgb.data(), frame.getRGB(), rgb.size() * sizeof(uint32_t)) == 0;
+        }
+    };
+
+    void paint(CFrame &frame, int x, int y, int len, int hei, uint32_t color)
+    {
+        for (int j = y; j < y + hei && j < frame.hei(); ++j)
+        {
+            for (int i = x; i < x + len && i < frame.len(); ++i)
+            {
+                frame.at(i, j) = color;
+            }
+        }
+    }
+
+    // edits before each push; the size straddles the tile grid
+    void testRoundTrip()
+    {
+        CFrame frame(150, 100);
+        paint(frame, 0, 0, 150, 100, 0xff102030);
+        CUndo undo(0, TILE);
+        std::vector<state_t> states;
+        for (int step = 0; step < 6; ++step)
+        {
+            states.emplace_back(frame);
+            undo.push(frame);
+            if (step == 3)
+            {
+                frame.resize(70, 130);
+            }
+            paint(frame, step * 23, step * 17, 40, 30, 0xff000000 | step * 0x151515);
+        }
+        const state_t last(frame);
+        CHECK(undo.depth() == 6);
+        CHECK(!undo.canRedo());
+
+        for (int step = 5; step >= 0; --step)
+        {
+            CHECK(undo.undo(frame));
+            CHECK(states[step] == frame);
+        }
+        CHECK(!undo.canUndo());
+        CHECK(!undo.undo(frame));
+        CHECK(states[0] == frame);
+
+        for (int step = 1; step < 6; ++step)
+        {
+            CHECK(undo.redo(frame));
+            CHECK(states[step] == frame);
+        }
+        CHECK(undo.redo(frame));
+        CHECK(last == frame);
+        CHECK(!undo.canRedo());
+        CHECK(!undo.redo(frame));
+
+        // a new edit drops the redo steps
+        CHECK(undo.undo(frame));
+        CHECK(undo.undo(frame));
+        CHECK(undo.canRedo());
+        undo.push(frame);
+        CHECK(!undo.canRedo());
+        CHECK(undo.depth() == 5);
+
+        undo.clear();
+        CHECK(!undo.canUndo() && !undo.canRedo());
+        CHECK(undo.size() == 0);
+    }
+
+    // a snapshot only costs the tiles that changed since the previous one
+    void testSharing()
+    {
+        CFrame frame(4 * TILE, 3 * TILE);
+        paint(frame, 0, 0, frame.len(), frame.hei(), 0xff808080);
+        CUndo undo(0, TILE);
+        undo.push(frame);
+        CHECK(undo.size() == 12 * TILE_BYTES);
+
+        undo.push(frame);
+        CHECK(undo.size() == 12 * TILE_BYTES);
+
+        frame.at(TILE + 5, 2 * TILE + 7) = 0xffff0000;
+        undo.push(frame);
+        CHECK(undo.size() == 13 * TILE_BYTES);
+
+        // two tiles touched by a line across their edge
+        paint(frame, TILE - 4, 10, 8, 1, 0xff00ff00);
+        undo.push(frame);
+        CHECK(undo.size() == 15 * TILE_BYTES);
+
+        // the redo step shares the tiles the frame has in common with the
+        // step it replaces
+        const state_t edited(frame);
+        CHECK(undo.undo(frame));
+        CHECK(undo.size() == 15 * TILE_BYTES);
+        CHECK(undo.redo(frame));
+        CHECK(edited == frame);
+        CHECK(undo.size() == 15 * TILE_BYTES);
+
+        // tiles are freed with the last snapshot that holds them
+        undo.clear();
+        CHECK(undo.size() == 0);
+
+        // different sizes share nothing
+        undo.push(frame);
+        frame.resize(TILE, TILE);
+        undo.push(frame);
+        CHECK(undo.size() == 13 * TILE_BYTES);
+    }
+
+    // every push rewrites all the tiles
+    void testTrim()
+    {
+        const size_t FRAME_BYTES = 4 * TILE_BYTES;
+        CFrame frame(2 * TILE, 2 * TILE);
+        CUndo undo(3 * FRAME_BYTES, TILE);
+        CHECK(undo.budget() == 3 * FRAME_BYTES);
+        std::vector<state_t> states;
+        for (int step = 0; step < 10; ++step)
+        {
+            paint(frame, 0, 0, frame.len(), frame.hei(), 0xff000000 | step);
+            states.emplace_back(frame);
+            undo.push(frame);
+            CHECK(undo.size() <= 3 * FRAME_BYTES);
+            CHECK(undo.depth() == std::min(step + 1, 3));
+        }
+
+        // the newest steps are the ones kept
+        paint(frame, 0, 0, frame.len(), frame.hei(), 0);
+        for (int step = 9; step >= 7; --step)
+        {
+            CHECK(undo.undo(frame));
+            CHECK(states[step] == frame);
+        }
+        CHECK(!undo.canUndo());
+
+        // unlimited
+        undo.clear();
+        undo.setBudget(0);
+        for (int step = 0; step < 10; ++step)
+        {
+            paint(frame, 0, 0, frame.len(), frame.hei(), 0xff000000 | step);
+            undo.push(frame);
+        }
+        CHECK(undo.depth() == 10);
+        CHECK(undo.size() == 10 * FRAME_BYTES);
+
+        // lowering the budget trims at once, but keeps the latest step
+        undo.setBudget(1);
+        CHECK(undo.depth() == 1);
+        CHECK(undo.size() == FRAME_BYTES);
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testSharing();
+    testTrim();
+    return TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+// Headless.cpp
+#include "Headless.h"
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+#include <algorithm>
+#include "ImageInfo.h"
+#include "ResizeThread.h"
+#include "Resampler.h"
+#include "ZipMode.h"
+
+namespace {
+
+const QStringList IMAGE_FILTERS = {"*.jpg", "*.jpeg", "*.png", "*.bmp", "*.gif", "*.tiff", "*.webp"};
+
+// Files matching one input: a file, a directory (its images) or a
+// wildcard pattern such as sprites/*.png
+QStringList expandInput(const QString &input)
+{
+    QFileInfo info(input);
+    QStringList files;
+    if (info.isDir()) {
+        QDir dir(input);
+        for (const QString &name : dir.entryList(IMAGE_FILTERS, QDir::Files, QDir::Name)) {
+            files.append(dir.filePath(name));
+        }
+    } else if (input.contains('*') || input.contains('?') || input.contains('[')) {
+        QDir dir(info.path());
+        for (const QString &name : dir.entryList({info.fileName()}, QDir::Files, QDir::Name)) {
+            files.append(dir.filePath(name));
+        }
+    } else if (info.isFile()) {
+        files.append(input);
+    }
+    return files;
+}
+
+}
+
+int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ImageResizerApp");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch image resizer, headless mode.");
+    parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", "Run without the GUI.");
+    QCommandLineOption widthOption({"W", "width"}, "Target width.", "pixels", "16");
+    QCommandLineOption heightOption({"H", "height"}, "Target height.", "pixels", "16");
+    QCommandLineOption aspectOption({"a", "aspect"}, "keep: fit inside width x height; stretch: exactly width x height.", "policy", "keep");
+    QCommandLineOption filterOption({"f", "filter"}, "nearest, box, bilinear, lanczos3 or scale2x.", "filter", resampleFilterName(RESAMPLE_LANCZOS3));
+    QCommandLineOption threadsOption({"j", "threads"}, "Worker threads (0: one per core).", "count", "0");
+    QCommandLineOption zipModeOption({"z", "zip-mode"}, "Zip entries: store, deflate or auto.", "mode", zipModeName(ZIP_MODE_AUTO));
+    QCommandLineOption outputOption({"o", "output"}, "Output .zip archive, or a directory for any other path.", "path");
+    parser.addOptions({headlessOption, widthOption, heightOption, aspectOption, filterOption, threadsOption, zipModeOption, outputOption});
+    parser.addPositionalArgument("inputs", "Image files, directories or wildcard patterns.", "<inputs...>");
+    parser.process(app);
+
+    bool widthOk, heightOk, threadsOk;
+    const int width = parser.value(widthOption).toInt(&widthOk);
+    const int height = parser.value(heightOption).toInt(&heightOk);
+    const int threads = parser.value(threadsOption).toInt(&threadsOk);
+    const QString aspect = parser.value(aspectOption);
+    const int filter = resampleFilterFromName(parser.value(filterOption).toLatin1().constData());
+    const int zipMode = zipModeFromName(parser.value(zipModeOption).toLatin1().constData());
+    const QString output = parser.value(outputOption);
+
+    QString usageError;
+    if (!widthOk || !heightOk || width < 1 || height < 1) {
+        usageError = "width and height must be positive integers";
+    } else if (aspect != "keep" && aspect != "stretch") {
+        usageError = "aspect must be keep or stretch";
+    } else if (filter < 0) {
+        usageError = QString("unknown filter %1").arg(parser.value(filterOption));
+    } else if (!threadsOk || threads < 0) {
+        usageError = "threads must be 0 or more";
+    } else if (zipMode < 0) {
+        usageError = QString("unknown zip mode %1").arg(parser.value(zipModeOption));
+    } else if (output.isEmpty()) {
+        usageError = "no output given (--output)";
+    } else if (parser.positionalArguments().isEmpty()) {
+        usageError = "no inputs given";
+    }
+    if (!usageError.isEmpty()) {
+        err << "ImageResizerApp: " << usageError << Qt::endl;
+        err << "Try --headless --help." << Qt::endl;
+        return 2;
+    }
+
+    QStringList files;
+    for (const QString &input : parser.positionalArguments()) {
+        const QStringList matches = expandInput(input);
+        if (matches.isEmpty()) {
+            err << "ImageResizerApp: no images match " << input << Qt::endl;
+        }
+        files.append(matches);
+    }
+    files.removeDuplicates();
+    if (files.isEmpty()) {
+        err << "ImageResizerApp: nothing to do" << Qt::endl;
+        return 1;
+    }
+
+    // Images are decoded by the workers, not here
+    QList<ImageInfo> list;
+    for (const QString &file : files) {
+        list.append({QImage(), file});
+    }
+
+    const bool toZip = output.endsWith(".zip", Qt::CaseInsensitive);
+    ResizeThread thread(list, width, height, aspect == "keep", output, filter, threads, zipMode);
+    thread.setDirectoryOutput(!toZip);
+
+    // No event loop here: the signals are handled on the emitting thread
+    // and read back once wait() returns
+    QString errorMessage;
+    QObject::connect(&thread, &ResizeThread::error, &thread, [&](const QString &message) {
+        errorMessage = message;
+    }, Qt::DirectConnection);
+
+    QElapsedTimer timer;
+    timer.start();
+    thread.start();
+    thread.wait();
+    const double seconds = std::max(timer.nsecsElapsed() / 1e9, 1e-9);
+
+    if (!errorMessage.isEmpty()) {
+        err << "ImageResizerApp: " << errorMessage << Qt::endl;
+        return 1;
+    }
+
+    const int workers = std::min(threads > 0 ? threads : QThread::idealThreadCount(), static_cast<int>(files.size()));
+    const double megabytes = thread.bytesWritten() / (1024.0 * 1024.0);
+    out << QString("%1 of %2 images -> %3 (%4, %5 threads)")
+               .arg(thread.imagesWritten())
+               .arg(files.size())
+               .arg(output)
+               .arg(resampleFilterName(filter))
+               .arg(workers) << Qt::endl;
+    out << QString("%1 s, %2 images/s, %3 MB written (%4 MB/s)")
+               .arg(seconds, 0, 'f', 2)
+               .arg(thread.imagesWritten() / seconds, 0, 'f', 1)
+               .arg(megabytes, 0, 'f', 1)
+               .arg(megabytes / seconds, 0, 'f', 1) << Qt::endl;
+    return 0;
+}
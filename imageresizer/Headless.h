@@ -0,0 +1,6 @@
+#pragma once
+
+// Batch mode without a display: `ImageResizerApp --headless [options] <inputs...>`
+// resizes through the same ResizeThread engine as the GUI and prints a
+// throughput summary. Returns the process exit code.
+int runHeadless(int argc, char *argv[]);
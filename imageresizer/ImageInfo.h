@@ -1,8 +1,8 @@
 #include <QString>
-#include <QPixmap>
+#include <QImage>
 #pragma once
 
 struct ImageInfo {
-    QPixmap pixmap;
+    QImage image;
     QString filepath;
 };
@@ -5,7 +5,9 @@
 #include <QHBoxLayout>
 #include <QBoxLayout>
 #include <QGroupBox>
+#include <algorithm>
 #include "ImageItem.h"
+#include "ResizeThread.h"
 
 ImageItem::ImageItem(const QString &filePath, QWidget *parent)
     : QWidget(parent)
@@ -61,44 +63,46 @@ void ImageItem::setupUI()
 
 void ImageItem::loadImage()
 {
-    m_originalPixmap = QPixmap(m_filePath);
+    m_originalImage = QImage(m_filePath).convertToFormat(QImage::Format_ARGB32);
     
-    if (!m_originalPixmap.isNull()) {
-        m_originalLabel->setPixmap(m_originalPixmap);
+    if (!m_originalImage.isNull()) {
+        // only the image is kept; the label gets a pixmap at its own size
+        m_originalLabel->setPixmap(QPixmap::fromImage(
+            m_originalImage.scaled(m_originalLabel->size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
         m_originalSizeLabel->setText(QString("Size: %1 x %2")
-                                   .arg(m_originalPixmap.width())
-                                   .arg(m_originalPixmap.height()));
+                                   .arg(m_originalImage.width())
+                                   .arg(m_originalImage.height()));
     } else {
         m_originalLabel->setText("Error loading image");
     }
 }
 
-void ImageItem::updatePreview(int targetWidth, int targetHeight, bool maintainAspect)
+void ImageItem::updatePreview(int targetWidth, int targetHeight, bool maintainAspect, int filter)
 {
-    if (m_originalPixmap.isNull()) return;
+    if (m_originalImage.isNull()) return;
     
     int newWidth, newHeight;
     
     if (maintainAspect) {
         // Calculate aspect ratio preserving dimensions
-        double aspectRatio = static_cast<double>(m_originalPixmap.width()) / m_originalPixmap.height();
+        double aspectRatio = static_cast<double>(m_originalImage.width()) / m_originalImage.height();
         
         if (static_cast<double>(targetWidth) / targetHeight > aspectRatio) {
             // Height is the limiting factor
             newHeight = targetHeight;
-            newWidth = static_cast<int>(targetHeight * aspectRatio);
+            newWidth = std::max(1, static_cast<int>(targetHeight * aspectRatio));
         } else {
             // Width is the limiting factor
             newWidth = targetWidth;
-            newHeight = static_cast<int>(targetWidth / aspectRatio);
+            newHeight = std::max(1, static_cast<int>(targetWidth / aspectRatio));
         }
     } else {
         newWidth = targetWidth;
         newHeight = targetHeight;
     }
     
-    // Create resized pixmap
-    m_resizedPixmap = m_originalPixmap.scaled(newWidth, newHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    // Create resized pixmap with the same resampler as the export
+    m_resizedPixmap = QPixmap::fromImage(ResizeThread::scaled(m_originalImage, newWidth, newHeight, filter));
     m_previewLabel->setPixmap(m_resizedPixmap);
     
     // Update size label
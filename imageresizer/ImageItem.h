@@ -3,6 +3,7 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QCheckBox>
 #include <QPixmap>
+#include <QImage>
 #include <QList>
 
 class ImageItem : public QWidget
@@ -12,18 +13,18 @@ class ImageItem : public QWidget
 public:
     explicit ImageItem(const QString &filePath, QWidget *parent = nullptr);
     
-    void updatePreview(int targetWidth, int targetHeight, bool maintainAspect);
+    void updatePreview(int targetWidth, int targetHeight, bool maintainAspect, int filter);
     bool isSelected() const;
     void setSelected(bool selected);
     QString getFilePath() const { return m_filePath; }
-    QPixmap getOriginalPixmap() const { return m_originalPixmap; }
+    QImage getOriginalImage() const { return m_originalImage; }
 
 private:
     void setupUI();
     void loadImage();
 
     QString m_filePath;
-    QPixmap m_originalPixmap;
+    QImage m_originalImage;
     QPixmap m_resizedPixmap;
     
     QCheckBox *m_checkBox;
@@ -12,6 +12,7 @@
 #include "ImageInfo.h"
 #include "ImageItem.h"
 #include "ResizeThread.h"
+#include "Resampler.h"
 
 ImageResizerApp::ImageResizerApp(QWidget *parent)
     : QMainWindow(parent)
@@ -39,11 +40,15 @@ void ImageResizerApp::loadSettings()
     int savedWidth = settings.value("targetWidth", 16).toInt();
     int savedHeight = settings.value("targetHeight", 16).toInt();
     bool savedMaintainAspect = settings.value("maintainAspect", true).toBool();
+    int savedFilter = m_filterComboBox->findData(resampleFilterFromName(
+        settings.value("filter", resampleFilterName(RESAMPLE_LANCZOS3)).toString().toLatin1().constData()));
 
     // Apply saved values
     m_widthSpinBox->setValue(savedWidth);
     m_heightSpinBox->setValue(savedHeight);
     m_aspectCheckBox->setChecked(savedMaintainAspect);
+    if (savedFilter >= 0)
+        m_filterComboBox->setCurrentIndex(savedFilter);
 
     // Also restore window geometry if saved
     restoreGeometry(settings.value("geometry").toByteArray());
@@ -57,6 +62,7 @@ void ImageResizerApp::saveSettings()
     settings.setValue("targetWidth", m_widthSpinBox->value());
     settings.setValue("targetHeight", m_heightSpinBox->value());
     settings.setValue("maintainAspect", m_aspectCheckBox->isChecked());
+    settings.setValue("filter", resampleFilterName(m_filterComboBox->currentData().toInt()));
 
     // Also save window geometry
     settings.setValue("geometry", saveGeometry());
@@ -98,6 +104,18 @@ void ImageResizerApp::setupUI()
     connect(m_aspectCheckBox, &QCheckBox::toggled, this, &ImageResizerApp::updatePreviews);
     controlsLayout->addWidget(m_aspectCheckBox, 1, 0, 1, 2);
     
+    // Resampling filter
+    controlsLayout->addWidget(new QLabel("Filter:"), 1, 2);
+    m_filterComboBox = new QComboBox;
+    m_filterComboBox->addItem("Nearest", RESAMPLE_NEAREST);
+    m_filterComboBox->addItem("Box", RESAMPLE_BOX);
+    m_filterComboBox->addItem("Bilinear", RESAMPLE_BILINEAR);
+    m_filterComboBox->addItem("Lanczos3", RESAMPLE_LANCZOS3);
+    m_filterComboBox->addItem("Scale2x (pixel art)", RESAMPLE_SCALE2X);
+    m_filterComboBox->setCurrentIndex(m_filterComboBox->findData(RESAMPLE_LANCZOS3));
+    connect(m_filterComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ImageResizerApp::updatePreviews);
+    controlsLayout->addWidget(m_filterComboBox, 1, 3);
+    
     controlsGroup->setLayout(controlsLayout);
     m_mainLayout->addWidget(controlsGroup);
     
@@ -242,9 +260,10 @@ void ImageResizerApp::updatePreviews()
     int targetWidth = m_widthSpinBox->value();
     int targetHeight = m_heightSpinBox->value();
     bool maintainAspect = m_aspectCheckBox->isChecked();
+    int filter = m_filterComboBox->currentData().toInt();
     
     for (ImageItem *item : m_imageItems) {
-        item->updatePreview(targetWidth, targetHeight, maintainAspect);
+        item->updatePreview(targetWidth, targetHeight, maintainAspect, filter);
     }
 }
 
@@ -310,7 +329,7 @@ void ImageResizerApp::exportImages()
         QList<ImageInfo> list;
         for (const auto &image: m_imageItems) {
             if (image->isSelected())
-                list.append({image->getOriginalPixmap(), image->getFilePath()});
+                list.append({image->getOriginalImage(), image->getFilePath()});
         }
         m_resizeThread = new ResizeThread(
             list,
@@ -318,6 +337,9 @@ void ImageResizerApp::exportImages()
             m_heightSpinBox->value(),
             m_aspectCheckBox->isChecked(),
             savePath,
+            m_filterComboBox->currentData().toInt(),
+            0,
+            ZIP_MODE_AUTO,
             this
             );
         connect(m_resizeThread, &ResizeThread::progress, this, &ImageResizerApp::updateProgress);
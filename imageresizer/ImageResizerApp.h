@@ -8,6 +8,7 @@
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QSpinBox>
+#include <QtWidgets/QComboBox>
 #include <QtWidgets/QScrollArea>
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QProgressBar>
@@ -59,6 +60,7 @@ private:
     QSpinBox *m_widthSpinBox;
     QSpinBox *m_heightSpinBox;
     QCheckBox *m_aspectCheckBox;
+    QComboBox *m_filterComboBox;
     QPushButton *m_selectAllBtn;
     QPushButton *m_selectNoneBtn;
     QPushButton *m_addFilesBtn;
@@ -1,28 +1,52 @@
 // ResizeThread.cpp
 #include "ResizeThread.h"
-#include <QtCore/QTemporaryDir>
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
-#include <QtGui/QPixmap>
+#include <QtCore/QFile>
+#include <QtGui/QImage>
 #include <QtCore/QProcess>
 #include <QtCore/QDebug>
 #include <qbuffer.h>
 #include <minizip/zip.h>  // Minizip header
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Resampler.h"
 
 
-ResizeThread::ResizeThread(const QList<ImageInfo> &imageItems, int targetWidth, int targetHeight, bool maintainAspect, const QString &savePath,QObject *parent)
+ResizeThread::ResizeThread(const QList<ImageInfo> &imageItems, int targetWidth, int targetHeight, bool maintainAspect, const QString &savePath, int filter, int threads, int zipMode, QObject *parent)
     : QThread(parent)
     , m_imageItems(imageItems)
     , m_targetWidth(targetWidth)
     , m_targetHeight(targetHeight)
     , m_maintainAspect(maintainAspect)
     , m_savePath(savePath)
+    , m_filter(filter)
+    , m_threads(threads)
+    , m_zipMode(zipMode)
 {
 }
 
+QImage ResizeThread::scaled(const QImage &image, int width, int height, int filter)
+{
+    const QImage src = image.format() == QImage::Format_ARGB32 ? image : image.convertToFormat(QImage::Format_ARGB32);
+    QImage dst(width, height, QImage::Format_ARGB32);
+    if (src.isNull() || dst.isNull()) {
+        return QImage();
+    }
+
+    // ARGB32 rows are whole 32-bit pixels with alpha in the high byte
+    if (!resample(reinterpret_cast<const uint32_t *>(src.constBits()), src.bytesPerLine() / 4, src.width(), src.height(),
+                  reinterpret_cast<uint32_t *>(dst.bits()), dst.bytesPerLine() / 4, width, height, filter)) {
+        return QImage();
+    }
+    return dst;
+}
+
 
 int createZip(const std::string &zipName, const std::string &filePath) {
     zipFile zf = zipOpen(zipName.c_str(), APPEND_STATUS_CREATE);
@@ -55,15 +79,172 @@ int createZip(const std::string &zipName, const std::string &filePath) {
     return 0;
 }
 
-void ResizeThread::run()
+namespace {
+
+// Encoded images handed from the resize workers to the zip writer.
+// Workers may run at most `capacity` images ahead of the writer, which
+// bounds memory and lets the writer take entries in input order; the
+// image the writer waits for is always inside the window, so this
+// cannot deadlock.
+const qsizetype WRITE_CHUNK = 1 << 30;
+
+class EntryQueue
 {
-    // Create temporary directory
-    QTemporaryDir tempDir;
-    if (!tempDir.isValid()) {
-        emit error("Failed to create temporary directory");
-        return;
+public:
+    EntryQueue(int count, int capacity)
+        : m_entries(count)
+        , m_ready(count, false)
+        , m_capacity(capacity)
+    {
+    }
+
+    // Block until image index may be produced; false once closed
+    bool waitForSlot(int index)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_slotFree.wait(lock, [&] { return m_closed || index < m_written + m_capacity; });
+        return !m_closed;
+    }
+
+    void put(int index, ResizeThread::Entry &&entry)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[index] = std::move(entry);
+        m_ready[index] = true;
+        m_entryReady.notify_all();
+    }
+
+    // Block until image index is encoded and take it; false once closed
+    bool take(int index, ResizeThread::Entry &entry)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entryReady.wait(lock, [&] { return m_closed || m_ready[index]; });
+        if (m_closed) return false;
+        entry = std::move(m_entries[index]);
+        m_written = index + 1;
+        m_slotFree.notify_all();
+        return true;
+    }
+
+    // Wake everyone up and refuse further work (error on either side)
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_slotFree.notify_all();
+        m_entryReady.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_slotFree;
+    std::condition_variable m_entryReady;
+    std::vector<ResizeThread::Entry> m_entries;
+    std::vector<bool> m_ready;
+    int m_capacity;
+    int m_written = 0;
+    bool m_closed = false;
+};
+
+// Add one entry to the archive
+bool addToZip(zipFile zf, const ResizeThread::Entry &entry, int zipMode, QString &message)
+{
+    // Already compressed formats (PNG, JPEG) are stored rather than deflated again
+    int method, level;
+    zipEntryMethod(entry.data.constData(), entry.data.size(), zipMode, method, level);
+    const bool zip64 = static_cast<quint64>(entry.data.size()) >= 0xffffffffULL;
+    
+    zip_fileinfo zfi = {};
+    int err = zipOpenNewFileInZip64(zf, entry.name.toStdString().c_str(), &zfi,
+                                    nullptr, 0, nullptr, 0,
+                                    "",//"File added via Minizip",
+                                    method, level, zip64);
+    if (err != ZIP_OK) {
+        message = "Could not zipOpenNewFileInZip.";
+        return false;
+    }
+    // zipWriteInFileInZip() takes at most 4 GB per call
+    for (qsizetype pos = 0; err == ZIP_OK && pos < entry.data.size(); pos += WRITE_CHUNK) {
+        const qsizetype len = std::min<qsizetype>(WRITE_CHUNK, entry.data.size() - pos);
+        err = zipWriteInFileInZip(zf, entry.data.constData() + pos, static_cast<unsigned>(len));
+    }
+    zipCloseFileInZip(zf);
+    if (err != ZIP_OK) {
+        message = "Could not zipWriteInFileInZip.";
+        return false;
+    }
+    return true;
+}
+
+// Write one entry as a file in dir
+bool saveToDirectory(const QString &dir, const ResizeThread::Entry &entry, QString &message)
+{
+    QFile file(dir + "/" + entry.name);
+    if (!file.open(QIODevice::WriteOnly) || file.write(entry.data) != entry.data.size()) {
+        message = QString("Could not write %1.").arg(file.fileName());
+        return false;
+    }
+    return true;
+}
+
+}
+
+bool ResizeThread::resizeImage(const ImageInfo &item, Entry &entry, QString &message) const
+{
+    // Images not decoded by the caller are loaded here, on the worker
+    const QImage originalImage = item.image.isNull() ? QImage(item.filepath) : item.image;
+    
+    if (originalImage.isNull()) return true;
+    
+    // Calculate dimensions
+    int newWidth, newHeight;
+    if (m_maintainAspect) {
+        double aspectRatio = static_cast<double>(originalImage.width()) / originalImage.height();
+        
+        if (static_cast<double>(m_targetWidth) / m_targetHeight > aspectRatio) {
+            newHeight = m_targetHeight;
+            newWidth = std::max(1, static_cast<int>(m_targetHeight * aspectRatio));
+        } else {
+            newWidth = m_targetWidth;
+            newHeight = std::max(1, static_cast<int>(m_targetWidth / aspectRatio));
+        }
+    } else {
+        newWidth = m_targetWidth;
+        newHeight = m_targetHeight;
+    }
+    
+    // Resize image
+    QImage resizedImage = scaled(originalImage, newWidth, newHeight, m_filter);
+    
+    // Encode in memory, in the format of the original file
+    QFileInfo fileInfo(item.filepath);
+    entry.name = fileInfo.baseName() + "." + fileInfo.suffix();
+    
+    QBuffer buffer(&entry.data);
+    buffer.open(QIODevice::WriteOnly);
+    if (resizedImage.isNull() || !resizedImage.save(&buffer, fileInfo.suffix().toLatin1().constData())) {
+        message = QString("Failed to encode resized image: %1").arg(entry.name);
+        return false;
     }
     
+    return true;
+}
+
+void ResizeThread::updateProgress(int count)
+{
+    // Called by every worker; only the one that moves the percentage emits
+    const int value = static_cast<int>(++m_done * 100LL / count);
+    int last = m_lastProgress;
+    while (value > last) {
+        if (m_lastProgress.compare_exchange_weak(last, value)) {
+            emit progress(value);
+            break;
+        }
+    }
+}
+
+void ResizeThread::run()
+{
     QString zipPath = m_savePath;
     
     if (m_imageItems.isEmpty()) {
@@ -71,87 +252,96 @@ void ResizeThread::run()
         return;
     }
     
-    // Create list of files to zip
-    QStringList filesToZip;
+    // Workers only read the list, through a const reference so that nothing detaches
+    const QList<ImageInfo> &items = m_imageItems;
+    const int count = items.size();
+    int threads = m_threads > 0 ? m_threads : QThread::idealThreadCount();
+    threads = std::max(1, std::min(threads, count));
     
-    for (int i = 0; i < m_imageItems.size(); ++i) {
-        const auto & item = m_imageItems[i];
-        const QPixmap &originalPixmap = item.pixmap;
-        
-        if (originalPixmap.isNull()) continue;
-        
-        // Calculate dimensions
-        int newWidth, newHeight;
-        if (m_maintainAspect) {
-            double aspectRatio = static_cast<double>(originalPixmap.width()) / originalPixmap.height();
-            
-            if (static_cast<double>(m_targetWidth) / m_targetHeight > aspectRatio) {
-                newHeight = m_targetHeight;
-                newWidth = static_cast<int>(m_targetHeight * aspectRatio);
-            } else {
-                newWidth = m_targetWidth;
-                newHeight = static_cast<int>(m_targetWidth / aspectRatio);
-            }
-        } else {
-            newWidth = m_targetWidth;
-            newHeight = m_targetHeight;
+    zipFile zf = nullptr;
+    if (m_directoryOutput) {
+        if (!QDir().mkpath(zipPath)) {
+            emit error(QString("Could not create directory %1.").arg(zipPath));
+            return;
         }
-        
-        // Resize pixmap
-        QPixmap resizedPixmap = originalPixmap.scaled(newWidth, newHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-        
-        // Save to temporary file
-        QFileInfo fileInfo(item.filepath);
-        QString tempImagePath = tempDir.path() + "/" + fileInfo.baseName() + "." + fileInfo.suffix();
-        
-        if (!resizedPixmap.save(tempImagePath)) {
-            emit error(QString("Failed to save resized image: %1").arg(tempImagePath));
+    } else {
+        // zip64 records are only written when the archive outgrows the classic format
+        zf = zipOpen64(zipPath.toStdString().c_str(), APPEND_STATUS_CREATE);
+        if (!zf) {
+            emit error( "Could not create file ZIP.");
             return;
         }
-        
-        filesToZip.append(tempImagePath);
-        
-        // Update progress
-        int progressValue = static_cast<int>((i + 1.0) / m_imageItems.size() * 100);
-        emit progress(progressValue);
     }
     
-    qDebug() << filesToZip;
-
-    zipFile zf = zipOpen(zipPath.toStdString().c_str(), APPEND_STATUS_CREATE);
-    if (!zf) {
-        emit error( "Could not create file ZIP.");
-        return;
-    }
-
-    for (const auto &filepath : filesToZip) {
-        QFileInfo fileInfo(filepath);
-        QString filename = fileInfo.fileName();
-        QFile sfile(filepath);
-        if (sfile.open( QIODevice::ReadOnly)) {
-            QByteArray pngData = sfile.readAll();
-            sfile.close();
-            zip_fileinfo zfi = {};
-            int err = zipOpenNewFileInZip(zf, filename.toStdString().c_str(), &zfi,
-                                          nullptr, 0, nullptr, 0,
-                                          "",//"File added via Minizip",
-                                          Z_DEFLATED, Z_DEFAULT_COMPRESSION);
-            if (err != ZIP_OK){
-                emit error( "Could not zipOpenNewFileInZip.");
+    // Resize and encode on a pool of workers; each one takes the next
+    // unclaimed index, so fast and slow images balance out by themselves.
+    // This thread writes the archive while they work.
+    EntryQueue queue(count, threads * 2);
+    std::atomic<int> next{0};
+    std::atomic<bool> failed{false};
+    QString errorMessage;
+    std::mutex errorMutex;
+    m_done = 0;
+    m_lastProgress = 0;
+    m_imagesWritten = 0;
+    m_bytesWritten = 0;
+    
+    auto fail = [&](const QString &message) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!failed.exchange(true)) {
+            errorMessage = message;
+        }
+        queue.close();
+    };
+    
+    auto worker = [&]() {
+        for (int i = next++; i < count && queue.waitForSlot(i); i = next++) {
+            Entry entry;
+            QString message;
+            if (!resizeImage(items.at(i), entry, message)) {
+                fail(message);
                 return;
             }
-            err = zipWriteInFileInZip(zf, pngData.constData(), pngData.size());
-            if (err != ZIP_OK) {
-                emit error( "Could not zipWriteInFileInZip.");
-                return ;
-            }
-        } else {
-            emit error( "Could not read file.");
-            return;
+            queue.put(i, std::move(entry));
+            updateProgress(count);
         }
+    };
+    
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
     }
-    zipCloseFileInZip(zf);
-    zipClose(zf, nullptr);
-    qDebug() << "ZIP archive saved successfully.";
+    
+    for (int i = 0; i < count; ++i) {
+        Entry entry;
+        if (!queue.take(i, entry)) break;
+        
+        // Unreadable images have no entry
+        if (entry.name.isEmpty()) continue;
+        
+        QString message;
+        const bool written = zf ? addToZip(zf, entry, m_zipMode, message)
+                                : saveToDirectory(zipPath, entry, message);
+        if (!written) {
+            fail(message);
+            break;
+        }
+        ++m_imagesWritten;
+        m_bytesWritten += entry.data.size();
+    }
+    
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    if (zf) {
+        zipClose(zf, nullptr);
+    }
+    
+    if (failed) {
+        emit error(errorMessage);
+        return;
+    }
+    
+    qDebug() << (zf ? "ZIP archive saved successfully." : "Images saved successfully.");
     emit finished(zipPath);
 }
@@ -4,9 +4,12 @@
 #include <QtCore/QMimeData>
 #include <QtGui/QDragEnterEvent>
 #include <QtGui/QDropEvent>
-#include <QtGui/QPixmap>
+#include <QtGui/QImage>
 #include <QList>
+#include <QByteArray>
+#include <atomic>
 #include "ImageInfo.h"
+#include "ZipMode.h"
 
 
 class ResizeThread : public QThread
@@ -14,7 +17,25 @@ class ResizeThread : public QThread
     Q_OBJECT
 
 public:
-    ResizeThread(const QList<ImageInfo> &imageItems, int targetWidth, int targetHeight, bool maintainAspect, const QString &savePath, QObject *parent = nullptr);
+    ResizeThread(const QList<ImageInfo> &imageItems, int targetWidth, int targetHeight, bool maintainAspect, const QString &savePath, int filter, int threads = 0, int zipMode = ZIP_MODE_AUTO, QObject *parent = nullptr);
+
+    // Resample image to width x height with a RESAMPLE_* filter (Resampler.h);
+    // needs no GUI, so it is safe off the main thread
+    static QImage scaled(const QImage &image, int width, int height, int filter);
+
+    // Save the images as files in the directory savePath (created if
+    // needed) instead of a zip archive
+    void setDirectoryOutput(bool enabled) { m_directoryOutput = enabled; }
+
+    // Totals of the last run, valid once finished() or error() is emitted
+    int imagesWritten() const { return m_imagesWritten; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+    // One encoded image on its way into the archive
+    struct Entry {
+        QString name;
+        QByteArray data;
+    };
 
 signals:
     void progress(int value);
@@ -25,10 +46,23 @@ protected:
     void run() override;
 
 private:
+    // Decode (if needed), resize and encode one image in memory; entry
+    // stays empty for images that cannot be read
+    bool resizeImage(const ImageInfo &item, Entry &entry, QString &message) const;
+    void updateProgress(int count);
+
     QList<ImageInfo> m_imageItems;
     int m_targetWidth;
     int m_targetHeight;
     bool m_maintainAspect;
     QString m_savePath;
+    int m_filter;
+    int m_threads; // workers (0: one per core)
+    int m_zipMode; // ZIP_MODE_* (ZipMode.h)
+    bool m_directoryOutput = false;
+    int m_imagesWritten = 0;
+    qint64 m_bytesWritten = 0;
+    std::atomic<int> m_done{0};
+    std::atomic<int> m_lastProgress{0};
 };
 
@@ -0,0 +1,85 @@
+// ZipMode.cpp
+#include "ZipMode.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char *MODE_NAMES[ZIP_MODE_COUNT] = {
+    "store",
+    "deflate",
+    "auto",
+};
+
+// ZIP_MODE_AUTO deflates a sample of this many bytes at level 1 and only
+// compresses the entry if the sample shrinks by at least MIN_GAIN percent
+const size_t SAMPLE_SIZE = 4 * 1024;
+const size_t MIN_GAIN = 3;
+
+// formats that carry their own compression
+bool isCompressed(const char *data, size_t size)
+{
+    static const struct {
+        const char *magic;
+        size_t size;
+    } formats[] = {
+        {"\x89PNG\r\n\x1a\n", 8},
+        {"\xff\xd8\xff", 3},  // JPEG
+        {"GIF8", 4},
+        {"PK\x03\x04", 4},   // zip
+        {"\x1f\x8b", 2},       // gzip
+    };
+    for (const auto &format : formats) {
+        if (size >= format.size && memcmp(data, format.magic, format.size) == 0) return true;
+    }
+    // WebP: RIFF....WEBP
+    return size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0;
+}
+
+bool worthDeflating(const char *data, size_t size)
+{
+    const size_t sample = std::min(size, SAMPLE_SIZE);
+    if (sample == 0 || isCompressed(data, size)) return false;
+
+    std::vector<Bytef> out(compressBound(sample));
+    z_stream zs = {};
+    // raw deflate as in the zip entry; a small window and hash keep the
+    // setup cheap, which matters for many small entries
+    if (deflateInit2(&zs, 1, Z_DEFLATED, -12, 4, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return true;
+    }
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs.avail_in = static_cast<uInt>(sample);
+    zs.next_out = out.data();
+    zs.avail_out = static_cast<uInt>(out.size());
+    const int err = deflate(&zs, Z_FINISH);
+    const size_t packed = zs.total_out;
+    deflateEnd(&zs);
+
+    return err == Z_STREAM_END && packed * 100 <= sample * (100 - MIN_GAIN);
+}
+
+}
+
+const char *zipModeName(int mode)
+{
+    return mode >= 0 && mode < ZIP_MODE_COUNT ? MODE_NAMES[mode] : nullptr;
+}
+
+int zipModeFromName(const char *name)
+{
+    for (int i = 0; name && i < ZIP_MODE_COUNT; ++i) {
+        if (strcmp(name, MODE_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+void zipEntryMethod(const char *data, size_t size, int mode, int &method, int &level)
+{
+    const bool deflated = mode == ZIP_MODE_DEFLATE
+        || (mode == ZIP_MODE_AUTO && worthDeflating(data, size));
+    method = deflated ? Z_DEFLATED : 0;
+    level = deflated ? Z_DEFAULT_COMPRESSION : 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+// How batch exports store their entries in the zip archive
+enum : int {
+    ZIP_MODE_STORE,   // no compression: PNG and JPEG data is compressed already
+    ZIP_MODE_DEFLATE, // deflate every entry at the default level
+    ZIP_MODE_AUTO,    // deflate only entries whose leading bytes measurably shrink
+    ZIP_MODE_COUNT
+};
+
+// "store", "deflate", "auto" (nullptr if unknown)
+const char *zipModeName(int mode);
+
+// reverse of zipModeName(); -1 if unknown
+int zipModeFromName(const char *name);
+
+// minizip method (0: stored, Z_DEFLATED) and level to use for an entry
+// holding data, according to mode
+void zipEntryMethod(const char *data, size_t size, int mode, int &method, int &level);
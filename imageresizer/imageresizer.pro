@@ -7,17 +7,26 @@ TEMPLATE = app
 
 #INCLUDEPATH += /usr/include/QuaZip-Qt6-1.5
 
+# the resampler is shared with colormapper
+INCLUDEPATH += ../colormapper/src/shared
+
 SOURCES += \
     main.cpp \
+    Headless.cpp \
     ImageItem.cpp \
     ResizeThread.cpp \
+    ../colormapper/src/shared/Resampler.cpp \
+    ZipMode.cpp \
     ImageResizerApp.cpp
 
 HEADERS += \
     ImageResizerApp.h \
+    Headless.h \
     ImageItem.h \
     ImageInfo.h \
+    ../colormapper/src/shared/Resampler.h \
+    ZipMode.h \
     ResizeThread.h
 
 #LIBS += -lfontconfig -lquazip1-qt6
-LIBS += -lfontconfig -lminizip
+LIBS += -lfontconfig -lminizip -lz
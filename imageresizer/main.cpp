@@ -1,9 +1,17 @@
 // main.cpp
 #include "ImageResizerApp.h"
+#include "Headless.h"
 #include <QApplication>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
+    // Batch mode for build pipelines: no QApplication, so no display needed
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0)
+            return runHeadless(argc, argv);
+    }
+    
     QApplication app(argc, argv);
     
     ImageResizerApp window;
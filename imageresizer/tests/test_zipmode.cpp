@@ -0,0 +1,88 @@
+// test_zipmode.cpp
+#include "check.h"
+#include "ZipMode.h"
+#include <zlib.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<char> noise(size_t size)
+{
+    std::vector<char> data(size);
+    uint32_t seed = 7;
+    for (auto &c : data) {
+        seed = seed * 1103515245 + 12345;
+        c = static_cast<char>(seed >> 24);
+    }
+    return data;
+}
+
+void expectMethod(const std::vector<char> &data, int mode, int method, int level)
+{
+    int m = -1;
+    int l = -1;
+    zipEntryMethod(data.data(), data.size(), mode, m, l);
+    CHECK(m == method);
+    CHECK(l == level);
+}
+
+void testNames()
+{
+    for (int mode = 0; mode < ZIP_MODE_COUNT; ++mode) {
+        CHECK(zipModeName(mode) != nullptr);
+        CHECK(zipModeFromName(zipModeName(mode)) == mode);
+    }
+    CHECK(std::string(zipModeName(ZIP_MODE_STORE)) == "store");
+    CHECK(std::string(zipModeName(ZIP_MODE_DEFLATE)) == "deflate");
+    CHECK(std::string(zipModeName(ZIP_MODE_AUTO)) == "auto");
+    CHECK(zipModeName(-1) == nullptr);
+    CHECK(zipModeName(ZIP_MODE_COUNT) == nullptr);
+    CHECK(zipModeFromName("zip") == -1);
+    CHECK(zipModeFromName("") == -1);
+    CHECK(zipModeFromName(nullptr) == -1);
+}
+
+void testMethods()
+{
+    const std::vector<char> text(10000, 'a');
+    const std::vector<char> random = noise(10000);
+    std::vector<char> png = text;
+    memcpy(png.data(), "\x89PNG\r\n\x1a\n", 8);
+    std::vector<char> jpeg = text;
+    memcpy(jpeg.data(), "\xff\xd8\xff", 3);
+    std::vector<char> webp = text;
+    memcpy(webp.data(), "RIFF\0\0\0\0WEBP", 12);
+    const std::vector<char> empty;
+
+    // store and deflate ignore the data
+    const std::vector<char> *entries[] = {&text, &random, &png, &empty};
+    for (const auto *data : entries) {
+        expectMethod(*data, ZIP_MODE_STORE, 0, 0);
+        expectMethod(*data, ZIP_MODE_DEFLATE, Z_DEFLATED, Z_DEFAULT_COMPRESSION);
+    }
+
+    // auto keeps compressed formats and incompressible data stored, even
+    // when the rest of the entry would shrink
+    expectMethod(text, ZIP_MODE_AUTO, Z_DEFLATED, Z_DEFAULT_COMPRESSION);
+    expectMethod(random, ZIP_MODE_AUTO, 0, 0);
+    expectMethod(png, ZIP_MODE_AUTO, 0, 0);
+    expectMethod(jpeg, ZIP_MODE_AUTO, 0, 0);
+    expectMethod(webp, ZIP_MODE_AUTO, 0, 0);
+    expectMethod(empty, ZIP_MODE_AUTO, 0, 0);
+
+    // only the leading sample is measured
+    std::vector<char> tail = noise(8 * 1024);
+    tail.insert(tail.end(), 100000, 'a');
+    expectMethod(tail, ZIP_MODE_AUTO, 0, 0);
+}
+
+}
+
+int main()
+{
+    testNames();
+    testMethods();
+    return TEST_RESULT();
+}
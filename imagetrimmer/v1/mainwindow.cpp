@@ -236,7 +236,10 @@ void MainWindow::saveZip() {
         QString fname = QString("image_%1.png").arg(i+1);
         QuaZipFile zf(&zip);
         QuaZipNewInfo zi(fname);//, QDateTime::currentDateTime());
-        if (!zf.open(QIODevice::WriteOnly, zi)) {
+        // PNG data is deflated already: store it (method 0) instead of deflating it again;
+        // entries of 4 GB and up need zip64 headers, which must be chosen before open()
+        zf.setZip64Enabled(static_cast<quint64>(ba.size()) >= 0xffffffffULL);
+        if (!zf.open(QIODevice::WriteOnly, zi, nullptr, 0, 0, 0)) {
             QMessageBox::warning(this, "ZIP Error", QString("Failed to add %1 to zip").arg(fname));
             continue;
         }
@@ -91,7 +91,8 @@ void MainWindow::saveZip() {
     QString zipPath = QFileDialog::getSaveFileName(this, "Save ZIP", "processed_images.zip", "ZIP Files (*.zip)");
     if (zipPath.isEmpty()) return;
 
-    zipFile zf = zipOpen(zipPath.toStdString().c_str(), APPEND_STATUS_CREATE);
+    // zip64 records are only written when the archive outgrows the classic format
+    zipFile zf = zipOpen64(zipPath.toStdString().c_str(), APPEND_STATUS_CREATE);
     if (!zf)
     //QuaZip zip(zipPath);
     //if (!zip.open(QuaZip::mdCreate)) {
@@ -103,26 +104,30 @@ void MainWindow::saveZip() {
     for (const auto &pair : images) {
         if (!pair.selected) continue;
 
+        QByteArray pngData;
+        QBuffer buffer(&pngData);
+        buffer.open(QIODevice::WriteOnly);
+        pair.processed.save(&buffer, "PNG");
+
         zip_fileinfo zfi = {};
         std::string entryName = pair.fileName.toStdString(); //filePath.substr(filePath.find_last_of("/\\") + 1);
 
-        int err = zipOpenNewFileInZip(zf, entryName.c_str(), &zfi,
-                                      nullptr, 0, nullptr, 0,
-                                      "File added via Minizip",
-                                      Z_DEFLATED, Z_DEFAULT_COMPRESSION);
+        // PNG data is deflated already: store it as is instead of deflating it again
+        int err = zipOpenNewFileInZip64(zf, entryName.c_str(), &zfi,
+                                        nullptr, 0, nullptr, 0,
+                                        "File added via Minizip",
+                                        0, 0, static_cast<quint64>(pngData.size()) >= 0xffffffffULL);
         if (err != ZIP_OK) {
             QMessageBox::warning(this, "Error", "Could not zipOpenNewFileInZip.");
+            zipClose(zf, nullptr);
             return;
         }
 
-        QByteArray pngData;
-        QBuffer buffer(&pngData);
-       // buffer.open(QIODevice::WriteOnly);
-        pair.processed.save(&buffer, "PNG");
-
-        err = zipWriteInFileInZip(zf, buffer.data(), buffer.size());
+        err = zipWriteInFileInZip(zf, pngData.constData(), pngData.size());
+        zipCloseFileInZip(zf);
         if (err != ZIP_OK) {
             QMessageBox::warning(this, "Error", "Could not zipWriteInFileInZip.");
+            zipClose(zf, nullptr);
             return ;
         }
         //QuaZipFile file(&zip);
@@ -137,7 +142,6 @@ void MainWindow::saveZip() {
     }
     //zip.close();
 
-    zipCloseFileInZip(zf);
     zipClose(zf, nullptr);
     QMessageBox::information(this, "Done", "ZIP archive saved successfully.");
 }
@@ -272,9 +272,15 @@ bool ImageViewer::isImageFile(const QString &filepath)
 
 bool ImageViewer::isAllSameSize(CFrameSet &set)
 {
-    for (const auto&frame:set.frames()) {
-        if (frame->width() != set[0]->width()
-            || frame->height() != set[0]->height())
+    // sizes come from the OBL5 index: the frames are not decoded here
+    int width;
+    int height;
+    set.frameSize(0, width, height);
+    for (size_t i = 1; i < set.getSize(); ++i) {
+        int w;
+        int h;
+        set.frameSize(i, w, h);
+        if (w != width || h != height)
             return false;
     }
     return true;
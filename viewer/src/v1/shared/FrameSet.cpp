@@ -109,6 +109,8 @@ CFrameSet::~CFrameSet()
 
 bool CFrameSet::writeSolid(IFile &file)
 {
+    if (!materialize())
+        return false;
 
     // Validate frame set
     const size_t size = getSize();
@@ -259,6 +261,8 @@ bool CFrameSet::write(IFile &file, const Format format)
 
     case OBL5_UNPACKED:
         // original version
+        if (!materialize())
+            return false;
         for (size_t i = 0; i < getSize(); ++i)
         {
             if (!m_arrFrames[i]->write(file))
@@ -387,6 +391,162 @@ bool CFrameSet::readSolid(IFile &file, int size)
         ptr += dataSize;
     }
 
+    return readTags(file);
+}
+
+bool CFrameSet::readFramed(IFile &file, int size)
+{
+    // Validate size
+    if (size <= 0 || size > MAX_IMAGES)
+    { // Prevent DoS
+        m_lastError = "Invalid frame count: " + std::to_string(size);
+        return false;
+    }
+
+    // OBL5 IMAGESET HEADER
+    // Read compressed size
+    uint32_t srcSize = 0;
+    if (file.read(&srcSize, sizeof(uint32_t)) != IFILE_OK || srcSize == 0)
+    {
+        m_lastError = "Failed to read or invalid compressed size";
+        return false;
+    }
+
+    // Validate file size
+    const long fileSize = file.getSize();
+    const int64_t indexSize = static_cast<int64_t>(size) * (2 * sizeof(uint16_t) + 2 * sizeof(uint32_t));
+    if (file.tell() + indexSize + srcSize > fileSize)
+    {
+        char tmp[128];
+        snprintf(tmp, sizeof(tmp), "File too small for OBL5_FRAMED data; data size=%u; file size=%ld)", srcSize, fileSize);
+        m_lastError = tmp;
+        return false;
+    }
+
+    // IMAGE HEADER [0..n]
+    // Only the index is parsed here: frames are inflated on first
+    // access (see operator[]) or all at once by materialize()
+    auto src = std::make_shared<std::vector<uint8_t>>(srcSize);
+    std::vector<packedFrame_t> entries(size);
+    for (int n = 0; n < size; ++n)
+    {
+        packedFrame_t &e = entries[n];
+        e.data = src;
+        if (file.read(&e.len, sizeof(e.len)) != IFILE_OK ||
+            file.read(&e.hei, sizeof(e.hei)) != IFILE_OK ||
+            file.read(&e.offset, sizeof(e.offset)) != IFILE_OK ||
+            file.read(&e.size, sizeof(e.size)) != IFILE_OK)
+        {
+            m_lastError = "Failed to read frame index";
+            return false;
+        }
+        if (e.len == 0 || e.hei == 0 || e.len > MAX_IMAGE_SIZE || e.hei > MAX_IMAGE_SIZE)
+        {
+            char tmp[128];
+            snprintf(tmp, sizeof(tmp), "Invalid frame dimensions [%d,%d] at index %d", e.len, e.hei, n);
+            m_lastError = tmp;
+            return false;
+        }
+        if (e.offset > srcSize || e.size > srcSize - e.offset)
+        {
+            m_lastError = "Corrupted frame index at index " + std::to_string(n);
+            return false;
+        }
+    }
+
+    // read OBL5Data (one zlib stream per frame)
+    if (file.read(src->data(), srcSize) != IFILE_OK)
+    {
+        m_lastError = "Failed to read compressed data";
+        return false;
+    }
+
+    // Placeholders until the frames are unpacked
+    m_packed.resize(m_arrFrames.size());
+    for (int n = 0; n < size; ++n)
+    {
+        m_arrFrames.emplace_back(nullptr);
+        m_packed.emplace_back(std::move(entries[n]));
+    }
+    m_packedCount = size;
+
+    return readTags(file);
+}
+
+bool CFrameSet::isPacked(int i) const
+{
+    return i < (int)m_packed.size() && m_packed[i].data;
+}
+
+int CFrameSet::unpack(int i) const
+{
+    // A frame that fails to decode stays packed
+    packedFrame_t &packed = m_packed[i];
+    auto frame = std::make_unique<CFrame>(packed.len, packed.hei);
+    const uLong expected = static_cast<uLong>(packed.len) * packed.hei * sizeof(PIXEL);
+    uLong destLen = expected;
+    int err = uncompress(
+        reinterpret_cast<uint8_t *>(frame->getRGB().data()),
+        &destLen,
+        packed.data->data() + packed.offset,
+        packed.size);
+    if (err == Z_OK && destLen != expected)
+        err = Z_DATA_ERROR;
+    if (err != Z_OK)
+    {
+        char tmp[128];
+        snprintf(tmp, sizeof(tmp), "Zlib error %d or size mismatch (%lu != %lu) at frame %d", err, destLen, expected, i);
+        m_lastError = tmp;
+        return err;
+    }
+    m_arrFrames[i] = frame.release();
+    packed.data.reset();
+    --m_packedCount;
+    return Z_OK;
+}
+
+bool CFrameSet::materialize()
+{
+    if (!m_packedCount)
+    {
+        m_packed.clear();
+        return true;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < m_packed.size(); ++i)
+    {
+        if (isPacked(i) && unpack(i) != Z_OK)
+        {
+            ++failed;
+            LOGE("%s", m_lastError.c_str());
+        }
+    }
+    if (failed)
+    {
+        m_lastError = "Failed to decode " + std::to_string(failed) + " OBL5 frame(s)";
+        return false;
+    }
+    m_packed.clear();
+    return true;
+}
+
+void CFrameSet::frameSize(int i, int &width, int &height) const
+{
+    std::lock_guard<std::mutex> lock(m_packedMutex);
+    if (i >= 0 && isPacked(i))
+    {
+        width = m_packed[i].len;
+        height = m_packed[i].hei;
+        return;
+    }
+    const CFrame *frame = i >= 0 && i < (int)m_arrFrames.size() ? m_arrFrames[i] : &tframe;
+    width = frame->width();
+    height = frame->height();
+}
+
+bool CFrameSet::readTags(IFile &file)
+{
     // Read tags
     uint32_t tagCount;
     if (file.read(&tagCount, sizeof(tagCount)) != IFILE_OK || tagCount > 100)
@@ -491,6 +651,10 @@ bool CFrameSet::read(IFile &file)
         result = readSolid(file, size);
         break;
 
+    case OBL5_FRAMED:
+        result = readFramed(file, size);
+        break;
+
     default:
         char tmp[128];
         snprintf(tmp, sizeof(tmp), "unknown OBL5 version: %x", version);
@@ -517,6 +681,12 @@ CFrame *CFrameSet::operator[](int n) const
     const size_t size = m_arrFrames.size();
     if (!(n & 0x8000) && n < (int)size && n >= 0)
     {
+        if (m_packedCount)
+        {
+            std::lock_guard<std::mutex> lock(m_packedMutex);
+            if (isPacked(n) && unpack(n) != Z_OK)
+                return &tframe;
+        }
         return m_arrFrames[n];
     }
     else
@@ -556,6 +726,8 @@ void CFrameSet::clear()
     for (size_t i = 0; i < size; ++i)
         delete m_arrFrames[i];
     m_arrFrames.clear();
+    m_packed.clear();
+    m_packedCount = 0;
     m_tags.clear();
 }
 
@@ -585,13 +757,18 @@ int CFrameSet::add(CFrame *pFrame)
     return m_arrFrames.size() - 1;
 }
 
-void CFrameSet::insertAt(int i, CFrame *pFrame)
+bool CFrameSet::insertAt(int i, CFrame *pFrame)
 {
+    if (!materialize())
+        return false;
     m_arrFrames.insert(m_arrFrames.begin() + i, pFrame);
+    return true;
 }
 
 CFrame *CFrameSet::removeAt(int i)
 {
+    if (!materialize())
+        return nullptr;
     CFrame *frame = m_arrFrames[i];
     m_arrFrames.erase(m_arrFrames.begin() + i);
     return frame;
@@ -610,6 +787,8 @@ void CFrameSet::setName(const char *str)
 void CFrameSet::removeAll()
 {
     m_arrFrames.clear();
+    m_packed.clear();
+    m_packedCount = 0;
 }
 
 std::unique_ptr<char[]> CFrameSet::ima2bitmap(char *ImaData, int len, int hei)
@@ -993,11 +1172,14 @@ bool CFrameSet::importOBL5(IFile &file, const long org)
         LOGW("Extra data after %s frame; possible format mismatch", FORMAT_OBL5);
     }
 
+    // Frames still packed are handed over without being inflated
     size_t size = frameSet.getSize();
-    // m_arrFrames.reserve(size);
+    m_packed.resize(m_arrFrames.size());
     for (size_t i = 0; i < size; ++i)
     {
-        m_arrFrames.emplace_back(frameSet[i]);
+        m_arrFrames.emplace_back(frameSet.m_arrFrames[i]);
+        m_packed.emplace_back(frameSet.isPacked(i) ? frameSet.m_packed[i] : packedFrame_t{});
+        m_packedCount += frameSet.isPacked(i);
     }
     frameSet.removeAll();
     return true;
@@ -1266,12 +1448,15 @@ const char *CFrameSet::getLastError() const
 void CFrameSet::move(int s, int t)
 {
     CFrame *f = removeAt(s);
-    insertAt(t, f);
+    if (f)
+        insertAt(t, f);
 }
 
 bool CFrameSet::toPng(std::vector<uint8_t> &png)
 {
     png.clear();
+    if (!materialize())
+        return false;
     const size_t size = m_arrFrames.size();
     if (size == 1)
     {
@@ -1343,6 +1528,8 @@ void CFrameSet::setTag(const char *tag, const char *v)
 
 void CFrameSet::toSubset(CFrameSet &dest, int start, int end)
 {
+    if (!materialize())
+        return;
     const int last = end == -1 ? getSize() - 1 : end;
     dest.reserve(last - start);
     for (int i = start; i <= last; ++i)
@@ -1361,6 +1548,11 @@ void CFrameSet::reserve(int n)
 
 void CFrameSet::set(const int i, CFrame *frame)
 {
+    if (isPacked(i))
+    {
+        m_packed[i].data.reset();
+        --m_packedCount;
+    }
     m_arrFrames[i] = frame;
 }
 
@@ -1376,11 +1568,22 @@ void CFrameSet::setCurrFrame(int curr)
 
 const std::vector<CFrame *> &CFrameSet::frames()
 {
-    return m_arrFrames;
+    // frames that cannot be decoded are left out rather than handed
+    // out as null pointers; getLastError() says how many were dropped
+    if (materialize())
+        return m_arrFrames;
+    m_decoded.clear();
+    for (CFrame *frame : m_arrFrames)
+    {
+        if (frame)
+            m_decoded.push_back(frame);
+    }
+    return m_decoded;
 }
 
 void CFrameSet::resize(int size)
 {
     // TODO: fix memory leaks
+    materialize();
     m_arrFrames.resize(size);
 }
@@ -23,6 +23,8 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include "ISerial.h"
 #include "ss_limits.h"
 
@@ -40,12 +42,15 @@ public:
     {
         OBL5_UNPACKED = 0x500,
         OBL5_SOLID = 0x501,
+        OBL5_FRAMED = 0x502,
         DEFAULT_OBL5_FORMAT = OBL5_SOLID,
     };
 
     size_t getSize();
     int operator++();
     int operator--();
+    // safe to call from several threads at once: OBL5_FRAMED frames are
+    // decoded on first access under a lock. Other members are not.
     CFrame *operator[](int) const;
     CFrameSet &operator=(CFrameSet &s);
     int add(CFrame *pFrame);
@@ -53,7 +58,7 @@ public:
     const char *getName() const;
 
     CFrame *removeAt(int n);
-    void insertAt(int n, CFrame *pFrame);
+    bool insertAt(int n, CFrame *pFrame);
     void clear();
     void removeAll();
     bool extract(IFile &file);
@@ -78,6 +83,9 @@ public:
     void setCurrFrame(int curr);
     const std::vector<CFrame *> &frames();
     void resize(int size);
+    bool materialize();
+    // size of frame i without decoding it (OBL5_FRAMED frames stay packed)
+    void frameSize(int i, int &width, int &height) const;
 
 private:
     int m_nCurrFrame;
@@ -95,6 +103,10 @@ private:
 
     bool writeSolid(IFile &file);
     bool readSolid(IFile &file, int size);
+    bool readFramed(IFile &file, int size);
+    bool readTags(IFile &file);
+    bool isPacked(int i) const;
+    int unpack(int i) const;
     static std::unique_ptr<char[]> ima2bitmap(char *ImaData, int len, int hei);
     static void bitmap2rgb(char *bitmap, uint32_t *rgb, int len, int hei, int err);
     bool importIMA(IFile &file, const long org = 0);
@@ -104,8 +116,22 @@ private:
     bool importOBL4(IFile &file, const long org = 0);
     bool importOBL5(IFile &file, const long org = 0);
 
-    std::string m_lastError;
-    std::vector<CFrame *> m_arrFrames;
+    // frame still held as its zlib stream (OBL5_FRAMED is loaded lazily)
+    struct packedFrame_t
+    {
+        std::shared_ptr<std::vector<uint8_t>> data;
+        uint32_t offset;
+        uint32_t size;
+        uint16_t len;
+        uint16_t hei;
+    };
+
+    mutable std::string m_lastError;
+    mutable std::vector<CFrame *> m_arrFrames;
+    mutable std::vector<packedFrame_t> m_packed;
+    std::vector<CFrame *> m_decoded; // frames() when some failed to decode
+    mutable std::atomic<int> m_packedCount{0};
+    mutable std::mutex m_packedMutex;
     std::string m_name;
     std::unordered_map<std::string, std::string> m_tags;
     friend class CFrameArray;